@@ -0,0 +1,512 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <charconv>
+#include <cmath>
+#include <QBuffer>
+#include <QCborStreamWriter>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "cborstream.h"
+
+
+/**
+ * @brief Number of bytes CborStreamWriter encodes before writing them to the device.
+ */
+static const int StreamChunk = 64 * 1024;
+
+/**
+ * @brief Largest magnitude up to which every integer is exactly a double.
+ */
+static const double ExactIntegerLimit = 9007199254740992.0;
+
+/**
+ * @brief Magnitude from which an integral double no longer fits in a qint64.
+ */
+static const double Int64Limit = 9223372036854775808.0;
+
+
+/**
+ * @brief CborStreamReader::CborStreamReader
+ * @param dev: An open device to read the document from
+ */
+
+CborStreamReader::CborStreamReader(QIODevice *dev) : reader(dev)
+{
+}
+
+
+/**
+ * @brief CborStreamReader::detect
+ *
+ * Recognize CBOR by the self-describe tag written by CborStreamWriter, or by
+ * a first byte that starts a map or an array. Neither can start a JSON text.
+ *
+ * @param dev: An open device
+ * @return Returns true if the data at the current position of dev is CBOR.
+ */
+
+bool CborStreamReader::detect(QIODevice *dev)
+{
+  QByteArray magic = dev->peek(3);
+
+
+  if(magic == QByteArray("\xd9\xd9\xf7", 3))
+    return true;
+
+  return !magic.isEmpty() && uchar(magic[0]) >= 0x80 && uchar(magic[0]) <= 0xbf;
+}
+
+
+/**
+ * @brief CborStreamReader::rawText
+ * @return Returns the digits of the integers of the document read that a
+ * double cannot hold exactly; null if there are none.
+ */
+
+QSharedPointer<RawText> CborStreamReader::rawText() const
+{
+  return raw;
+}
+
+
+/**
+ * @brief CborStreamReader::offset
+ * @return Returns the byte offset in the input where read() stopped, e.g.
+ * at an error. Unlike QJsonParseError::offset, it is not limited to 2 GiB.
+ */
+
+qint64 CborStreamReader::offset() const
+{
+  return reader.currentOffset();
+}
+
+
+/**
+ * @brief CborStreamReader::readText
+ *
+ * Read a text string, which may arrive in chunks.
+ *
+ * @param str: Receives the string
+ * @return Returns false on error.
+ */
+
+bool CborStreamReader::readText(QString *str)
+{
+  QCborStreamReader::StringResult<QString> chunk = reader.readString();
+
+
+  str->clear();
+  while(chunk.status == QCborStreamReader::Ok) {
+      *str += chunk.data;
+      chunk = reader.readString();
+  }
+
+  return chunk.status == QCborStreamReader::EndOfString;
+}
+
+
+/**
+ * @brief CborStreamReader::readKey
+ *
+ * Read the key of a map member. Integer keys are converted to strings.
+ *
+ * @param key: Receives the key
+ * @return Returns false on error, or for a key of another type.
+ */
+
+bool CborStreamReader::readKey(QString *key)
+{
+  while(reader.isTag())
+    reader.next();
+
+  if(reader.isString())
+    return readText(key);
+
+  if(reader.isUnsignedInteger())
+    *key = QString::number(reader.toUnsignedInteger());
+  else if(reader.isNegativeInteger())
+    *key = QString::number(reader.toInteger());
+  else
+    return false;
+
+  return reader.next();
+}
+
+
+/**
+ * @brief CborStreamReader::readScalar
+ *
+ * Read a value that is not a map or an array.
+ *
+ * @param val: Receives the value
+ * @param text: Receives the digits of an integer that a double cannot hold
+ * exactly; cleared otherwise
+ * @return Returns false on error.
+ */
+
+bool CborStreamReader::readScalar(QJsonValue *val, QByteArray *text)
+{
+  text->clear();
+
+  switch(reader.type()) {
+
+    case QCborStreamReader::String: {
+      QString str;
+      if(!readText(&str))
+        return false;
+      *val = QJsonValue(str);
+      return true;
+    }
+
+    case QCborStreamReader::ByteArray: {
+      QByteArray bytes;
+      QCborStreamReader::StringResult<QByteArray> chunk = reader.readByteArray();
+      while(chunk.status == QCborStreamReader::Ok) {
+          bytes += chunk.data;
+          chunk = reader.readByteArray();
+      }
+      if(chunk.status != QCborStreamReader::EndOfString)
+        return false;
+      *val = QJsonValue(QString::fromLatin1(bytes.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals)));
+      return true;
+    }
+
+    case QCborStreamReader::UnsignedInteger: {
+      quint64 n = reader.toUnsignedInteger();
+      *val = QJsonValue(double(n));
+      if(double(n) >= ExactIntegerLimit)
+        *text = QByteArray::number(n);
+      break;
+    }
+
+    case QCborStreamReader::NegativeInteger: {
+      // The absolute value; 0 stands for -2^64.
+      quint64 n = quint64(reader.toNegativeInteger());
+      double d = (n == 0) ? -18446744073709551616.0 : -double(n);
+      *val = QJsonValue(d);
+      if(d <= -ExactIntegerLimit)
+        *text = (n == 0) ? QByteArray("-18446744073709551616") : QByteArray("-") + QByteArray::number(n);
+      break;
+    }
+
+    case QCborStreamReader::Float16:
+      *val = QJsonValue(double(float(reader.toFloat16())));
+      break;
+
+    case QCborStreamReader::Float:
+      *val = QJsonValue(double(reader.toFloat()));
+      break;
+
+    case QCborStreamReader::Double:
+      *val = QJsonValue(reader.toDouble());
+      break;
+
+    case QCborStreamReader::SimpleType:
+      if(reader.isBool())
+        *val = QJsonValue(reader.toBool());
+      else
+        *val = QJsonValue(QJsonValue::Null);
+      break;
+
+    default:
+      return false;
+  }
+
+  if(val->isDouble() && !std::isfinite(val->toDouble()))
+    *val = QJsonValue(QJsonValue::Null);
+
+  if(!text->isEmpty() && JsonStreamWriter::isCanonical(text->constData(), text->size(), val->toDouble()))
+    text->clear();
+
+  return reader.next();
+}
+
+
+/**
+ * @brief CborStreamReader::read
+ *
+ * Read the document. The top-level value must be a map or an array.
+ *
+ * @param err: Receives the result; the offset is a byte offset in the input
+ * @return Returns the top-level object or array; an undefined value on error.
+ */
+
+QJsonValue CborStreamReader::read(QJsonParseError *err)
+{
+  QVector<ReadFrame> stack;
+  QJsonValue value;
+  QByteArray valueText;
+  QSharedPointer<RawText> valueRaw;
+  bool ok, done = false;
+
+
+  raw.reset();
+  while(reader.isTag())
+    reader.next();
+  ok = reader.isMap() || reader.isArray();
+
+  while(ok && !done) {
+
+      // Read one value; a map or array is opened instead.
+      while(reader.isTag())
+        reader.next();
+      valueText.clear();
+      valueRaw.reset();
+
+      if(reader.isMap() || reader.isArray()) {
+          bool object = reader.isMap();
+
+          if(!reader.enterContainer()) {
+              ok = false;
+              break;
+          }
+
+          stack.append(ReadFrame{object, {}, QJsonArray(), QString(), QSharedPointer<RawText>()});
+          if(reader.hasNext()) {
+              if(object)
+                ok = readKey(&stack.last().key);
+              continue;
+          }
+
+          ok = reader.leaveContainer();
+          stack.removeLast();
+          value = object ? QJsonValue(QJsonObject()) : QJsonValue(QJsonArray());
+      }
+      else {
+          ok = readScalar(&value, &valueText);
+      }
+
+      // Add the value to its container, closing every container it completes.
+      while(ok) {
+          if(stack.isEmpty()) {
+              raw = valueRaw;
+              done = true;
+              break;
+          }
+
+          ReadFrame &top = stack.last();
+          if(!valueText.isEmpty() || !valueRaw.isNull()) {
+              if(top.raw.isNull())
+                top.raw = QSharedPointer<RawText>::create();
+              if(!valueText.isEmpty())
+                top.raw->numbers.insert(top.name(), valueText);
+              else
+                top.raw->children.insert(top.name(), valueRaw);
+              valueText.clear();
+          }
+
+          if(top.object)
+            top.members.append(qMakePair(top.key, value));
+          else
+            top.array.append(value);
+
+          if(reader.hasNext()) {
+              if(top.object)
+                ok = readKey(&top.key);
+              break;
+          }
+
+          ok = reader.leaveContainer();
+          value = top.object ? QJsonValue(JsonStreamReader::buildObject(top.members)) : QJsonValue(top.array);
+          valueRaw = top.raw;
+          stack.removeLast();
+      }
+  }
+
+  err->offset = parseErrorOffset(reader.currentOffset());
+  if(!ok || reader.lastError() != QCborError::NoError) {
+      if(reader.lastError() == QCborError::EndOfFile && !stack.isEmpty())
+        err->error = stack.last().object ? QJsonParseError::UnterminatedObject : QJsonParseError::UnterminatedArray;
+      else
+        err->error = QJsonParseError::IllegalValue;
+      raw.reset();
+      return QJsonValue(QJsonValue::Undefined);
+  }
+
+  err->error = QJsonParseError::NoError;
+  return value;
+}
+
+
+/**
+ * @brief appendNumber
+ *
+ * Append a number to a CBOR stream. Integral numbers are written as
+ * integers. An integer text from a RawText is written exactly, even where
+ * the double has lost its last digits.
+ *
+ * @param writer: The stream
+ * @param d: The number
+ * @param text: Its original text; may be empty
+ */
+
+static void appendNumber(QCborStreamWriter &writer, double d, const QByteArray &text)
+{
+  const char *first = text.constData();
+  const char *last = first + text.size();
+  qint64 i;
+  quint64 u;
+
+
+  if(!text.isEmpty()) {
+      std::from_chars_result result = std::from_chars(first, last, i);
+      if(result.ec == std::errc() && result.ptr == last) {
+          writer.append(i);
+          return;
+      }
+
+      bool negative = (text[0] == '-');
+      result = std::from_chars(negative ? first + 1 : first, last, u);
+      if(result.ec == std::errc() && result.ptr == last) {
+          if(negative)
+            writer.append(QCborNegativeInteger(u));
+          else
+            writer.append(u);
+          return;
+      }
+  }
+
+  if(!std::isfinite(d))
+    writer.appendNull();
+  else if(d == std::floor(d) && std::fabs(d) < Int64Limit)
+    writer.append(qint64(d));
+  else
+    writer.append(d);
+}
+
+
+/**
+ * @brief appendScalar
+ *
+ * Append a value that is not an object or array to a CBOR stream.
+ */
+
+static void appendScalar(QCborStreamWriter &writer, const QJsonValue &val)
+{
+  switch(val.type()) {
+
+    case QJsonValue::Type::Bool:
+      writer.append(val.toBool());
+      break;
+
+    case QJsonValue::Type::Double:
+      appendNumber(writer, val.toDouble(), QByteArray());
+      break;
+
+    case QJsonValue::Type::String:
+      writer.append(val.toString());
+      break;
+
+    default:
+      writer.appendNull();
+      break;
+  }
+}
+
+
+/**
+ * @brief CborStreamWriter::write
+ *
+ * Write a document as CBOR, starting with the self-describe tag. Maps and
+ * arrays are written with their length. The encoded bytes are written to the
+ * device a block at a time; open objects and arrays are kept on an explicit stack.
+ *
+ * @param dev: An open device
+ * @param doc: The document
+ * @param raw: Original text of numbers, as returned by JsonStreamReader::rawText()
+ * @return Returns false if the device could not be written.
+ */
+
+bool CborStreamWriter::write(QIODevice *dev, const QJsonDocument &doc, const QSharedPointer<RawText> &raw)
+{
+  QVector<WriteFrame> stack;
+  QBuffer out;
+
+
+  out.open(QIODevice::WriteOnly);
+  QCborStreamWriter writer(&out);
+
+  auto open = [&stack, &writer](const QJsonValue &val, const QSharedPointer<RawText> &text) {
+      if(val.isObject()) {
+          QJsonObject jobj = val.toObject();
+          stack.append(WriteFrame{jobj, QJsonArray(), true, 0, jobj.size(), text});
+          writer.startMap(quint64(jobj.size()));
+      }
+      else {
+          QJsonArray jarr = val.toArray();
+          stack.append(WriteFrame{QJsonObject(), jarr, false, 0, jarr.size(), text});
+          writer.startArray(quint64(jarr.size()));
+      }
+  };
+
+  writer.append(QCborKnownTags::Signature);
+  open(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), raw);
+
+  while(!stack.isEmpty()) {
+      WriteFrame &top = stack.last();
+
+      if(top.next == top.count) {
+          if(top.object)
+            writer.endMap();
+          else
+            writer.endArray();
+          stack.removeLast();
+      }
+      else {
+          QJsonValue val;
+          QString name;
+          int i = top.next++;
+
+          if(top.object) {
+              QJsonObject::const_iterator it = top.jobj.constBegin() + i;
+              writer.append(it.key());
+              val = it.value();
+              name = it.key();
+          }
+          else {
+              val = top.jarr.at(i);
+              if(!top.raw.isNull())
+                name = QString::number(i);
+          }
+
+          if(val.isObject() || val.isArray())
+            open(val, top.raw.isNull() ? QSharedPointer<RawText>() : top.raw->children.value(name));
+          else if(val.isDouble() && !top.raw.isNull())
+            appendNumber(writer, val.toDouble(), top.raw->numbers.value(name));
+          else
+            appendScalar(writer, val);
+      }
+
+      if(out.size() >= StreamChunk) {
+          if(dev->write(out.data()) != out.size())
+            return false;
+          out.buffer().clear();
+          out.seek(0);
+      }
+  }
+
+  return dev->write(out.data()) == out.size();
+}
@@ -0,0 +1,81 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QCborStreamReader>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QSharedPointer>
+#include "jsonstream.h"
+
+
+/**
+ * @brief The CborStreamReader class
+ *
+ * Reads a CBOR document (RFC 7049) from a QIODevice with QCborStreamReader,
+ * building the QJsonValue tree directly, without a QCborValue in between.
+ * Open objects and arrays are kept on an explicit stack.
+ *
+ * CBOR values are mapped to JSON like QCborValue::toJsonValue() does: byte
+ * strings become base64url strings, integer map keys become strings, tags
+ * are skipped and undefined becomes null. Integers that a double cannot hold
+ * exactly keep their digits in a RawText.
+ */
+class CborStreamReader
+{
+public:
+  explicit CborStreamReader(QIODevice *dev);
+
+  static bool detect(QIODevice *dev);
+
+  QJsonValue read(QJsonParseError *err);
+  QSharedPointer<RawText> rawText() const;
+  qint64 offset() const;
+
+private:
+  QCborStreamReader        reader;
+  QSharedPointer<RawText>  raw;     /**< Number texts of the document read */
+
+  bool readText(QString *str);
+  bool readKey(QString *key);
+  bool readScalar(QJsonValue *val, QByteArray *text);
+};
+
+
+/**
+ * @brief The CborStreamWriter class
+ *
+ * Writes a document to a QIODevice as CBOR with QCborStreamWriter, in blocks,
+ * without building a QCborValue. Integral numbers are written as integers;
+ * integers listed in a RawText are written exactly.
+ */
+class CborStreamWriter
+{
+public:
+  static bool write(QIODevice *dev, const QJsonDocument &doc, const QSharedPointer<RawText> &raw = QSharedPointer<RawText>());
+};
@@ -0,0 +1,298 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "columnstore.h"
+
+
+/**
+ * @brief ColumnStore::ColumnStore
+ *
+ * Create an empty store. Use build() to create a store for an array.
+ */
+
+ColumnStore::ColumnStore() : rows(0)
+{
+}
+
+
+/**
+ * @brief ColumnStore::build
+ *
+ * Store an array column-wise, if it is a homogeneous array of objects.
+ *
+ * @param jarr: The array
+ * @return Returns a new ColumnStore, owned by the caller; nullptr if the
+ * array is too short or its elements do not all have the same shape.
+ */
+
+ColumnStore *ColumnStore::build(const QJsonArray &jarr)
+{
+  ColumnStore *store;
+
+
+  if(jarr.size() < MinimumRows || !jarr.at(0).isObject())
+    return nullptr;
+
+  QJsonObject first = jarr.at(0).toObject();
+  if(first.isEmpty())
+    return nullptr;
+
+  store = new ColumnStore;
+  store->keyList = first.keys();
+  for(auto it = first.constBegin(); it != first.constEnd(); ++it) {
+      ColumnData column;
+      column.type = it.value().type();
+      if(column.type == QJsonValue::Object || column.type == QJsonValue::Array) {
+          delete store;
+          return nullptr;
+      }
+      store->columns.append(column);
+  }
+
+  for(int i = 0; i < jarr.size(); i++) {
+      if(!jarr.at(i).isObject() || !store->append(jarr.at(i).toObject())) {
+          delete store;
+          return nullptr;
+      }
+  }
+
+  return store;
+}
+
+
+/**
+ * @brief ColumnStore::append
+ *
+ * Add a record at the end of the columns.
+ *
+ * @param record: The record
+ * @return Returns false if the record does not have the shape of the store;
+ * the store is then incomplete and must be discarded.
+ */
+
+bool ColumnStore::append(const QJsonObject &record)
+{
+  int i = 0;
+
+
+  if(record.size() != keyList.count())
+    return false;
+
+  // QJsonObject keeps its keys sorted, so equal key sets come in the same order.
+  for(auto it = record.constBegin(); it != record.constEnd(); ++it, i++) {
+      if(it.key() != keyList[i] || it.value().type() != columns[i].type)
+        return false;
+
+      switch(columns[i].type) {
+
+        case QJsonValue::Double:
+          columns[i].numbers.append(it.value().toDouble());
+          break;
+
+        case QJsonValue::String:
+          columns[i].strings.append(it.value().toString());
+          break;
+
+        case QJsonValue::Bool:
+          columns[i].flags.append(it.value().toBool());
+          break;
+
+        default:
+          break;
+      }
+  }
+
+  rows++;
+  return true;
+}
+
+
+/**
+ * @brief ColumnStore::rowCount
+ * @return Returns the number of records.
+ */
+
+int ColumnStore::rowCount() const
+{
+  return rows;
+}
+
+
+/**
+ * @brief ColumnStore::columnCount
+ * @return Returns the number of keys.
+ */
+
+int ColumnStore::columnCount() const
+{
+  return keyList.count();
+}
+
+
+/**
+ * @brief ColumnStore::keys
+ * @return Returns the keys of the records, in QJsonObject order.
+ */
+
+const QStringList &ColumnStore::keys() const
+{
+  return keyList;
+}
+
+
+/**
+ * @brief ColumnStore::type
+ * @param column: Index of a key
+ * @return Returns the type of the values of the column.
+ */
+
+QJsonValue::Type ColumnStore::type(int column) const
+{
+  return columns[column].type;
+}
+
+
+/**
+ * @brief ColumnStore::value
+ *
+ * @param row: Index of the record
+ * @param column: Index of the key
+ * @return Returns the value of the key in the record.
+ */
+
+QJsonValue ColumnStore::value(int row, int column) const
+{
+  const ColumnData &data = columns[column];
+
+
+  switch(data.type) {
+
+    case QJsonValue::Double:
+      return QJsonValue(data.numbers[row]);
+
+    case QJsonValue::String:
+      return QJsonValue(data.strings[row]);
+
+    case QJsonValue::Bool:
+      return QJsonValue(data.flags[row]);
+
+    default:
+      return QJsonValue();
+  }
+}
+
+
+/**
+ * @brief ColumnStore::set
+ *
+ * Replace one value. The type of val must be the type of the column.
+ */
+
+void ColumnStore::set(int row, int column, const QJsonValue &val)
+{
+  ColumnData &data = columns[column];
+
+
+  switch(data.type) {
+
+    case QJsonValue::Double:
+      data.numbers[row] = val.toDouble();
+      break;
+
+    case QJsonValue::String:
+      data.strings[row] = val.toString();
+      break;
+
+    case QJsonValue::Bool:
+      data.flags[row] = val.toBool();
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/**
+ * @brief ColumnStore::setRecord
+ *
+ * Replace a record after it was edited.
+ *
+ * @param row: Index of the record
+ * @param record: The new value of the record
+ * @return Returns false, leaving the store unchanged, if the new record does
+ * not have the shape of the store.
+ */
+
+bool ColumnStore::setRecord(int row, const QJsonValue &record)
+{
+  QJsonObject jobj = record.toObject();
+  int i = 0;
+
+
+  if(row < 0 || row >= rows || !record.isObject() || jobj.size() != keyList.count())
+    return false;
+
+  for(auto it = jobj.constBegin(); it != jobj.constEnd(); ++it, i++)
+    if(it.key() != keyList[i] || it.value().type() != columns[i].type)
+      return false;
+
+  i = 0;
+  for(auto it = jobj.constBegin(); it != jobj.constEnd(); ++it, i++)
+    set(row, i, it.value());
+
+  return true;
+}
+
+
+
+/**
+ * @brief ColumnStore::bytes
+ *
+ * Approximate memory held by the store: the typed vectors and the text of
+ * the strings, which are copies of those in the document. Used by the
+ * --benchmark mode to weigh the store against the TreeNodes it replaces.
+ *
+ * @return Returns the size in bytes.
+ */
+
+qint64 ColumnStore::bytes() const
+{
+  qint64 total = sizeof(ColumnStore) + qint64(columns.capacity()) * qint64(sizeof(ColumnData));
+
+
+  for(const QString &key : keyList)
+    total += sizeof(QString) + key.capacity() * qint64(sizeof(QChar));
+
+  for(const ColumnData &data : columns) {
+      total += qint64(data.numbers.capacity()) * qint64(sizeof(double));
+      total += qint64(data.flags.capacity()) * qint64(sizeof(bool));
+      total += qint64(data.strings.capacity()) * qint64(sizeof(QString));
+      for(const QString &text : data.strings)
+        total += text.capacity() * qint64(sizeof(QChar));
+  }
+
+  return total;
+}
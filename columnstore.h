@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+
+
+/**
+ * @brief The ColumnData struct
+ *
+ * The values of one key of a ColumnStore. All values of a column have the
+ * same type, and only the vector for that type is used.
+ */
+struct ColumnData {
+
+  QJsonValue::Type  type;     /**< Type of every value in the column */
+  QVector<double>   numbers;  /**< Values of a Double column */
+  QVector<QString>  strings;  /**< Values of a String column */
+  QVector<bool>     flags;    /**< Values of a Bool column; Null columns store nothing */
+};
+
+
+/**
+ * @brief The ColumnStore class
+ *
+ * Column-wise copy of a homogeneous array of objects: an array whose
+ * elements are all objects with the same keys, where each key has scalar
+ * values of a single type. The key list is stored once, and one typed
+ * vector per key holds the values.
+ *
+ * The array stays unpopulated in the tree until it is expanded, so its
+ * records need no TreeNodes; the table view reads the columns directly.
+ */
+class ColumnStore
+{
+public:
+  static ColumnStore *build(const QJsonArray &jarr);
+
+  int rowCount() const;
+  int columnCount() const;
+  const QStringList &keys() const;
+  QJsonValue::Type type(int column) const;
+  QJsonValue value(int row, int column) const;
+  bool setRecord(int row, const QJsonValue &record);
+  qint64 bytes() const;
+
+  /**
+   * @brief Smallest number of records for which an array is stored column-wise.
+   */
+  static const int MinimumRows = 2;
+
+private:
+  QStringList          keyList;
+  QVector<ColumnData>  columns;
+  int                  rows;
+
+  ColumnStore();
+  bool append(const QJsonObject &record);
+  void set(int row, int column, const QJsonValue &val);
+};
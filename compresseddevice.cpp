@@ -0,0 +1,531 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <cstring>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <zlib.h>
+#ifdef QJTREE_ZSTD
+#include <zstd.h>
+#endif
+#include "compresseddevice.h"
+
+
+/**
+ * @brief Size of the blocks of compressed data read or written at a time.
+ */
+static const int InputChunk = 64 * 1024;
+
+/**
+ * @brief Size of the blocks of decompressed data handed to the reader.
+ */
+static const int OutputChunk = 256 * 1024;
+
+/**
+ * @brief Number of decompressed blocks the worker thread may be ahead of the reader.
+ */
+static const int QueueLength = 4;
+
+
+/**
+ * @brief The CompressionState struct
+ *
+ * The zlib or zstd stream of a CompressedDevice, kept out of the header so
+ * that the compression libraries are only needed by compresseddevice.cpp.
+ */
+struct CompressionState {
+
+  z_stream        zs;       /**< gzip stream */
+#ifdef QJTREE_ZSTD
+  ZSTD_DStream   *dstream;  /**< zstd stream, when reading */
+  ZSTD_CStream   *cstream;  /**< zstd stream, when writing */
+#endif
+
+  CompressionState() {
+    std::memset(&zs, 0, sizeof(zs));
+#ifdef QJTREE_ZSTD
+    dstream = nullptr;
+    cstream = nullptr;
+#endif
+  }
+};
+
+
+/**
+ * @brief CompressedDevice::CompressedDevice
+ *
+ * @param dev: The device compressed data is read from or written to; it must
+ * be open, and is not used by the caller while this device is open
+ * @param fmt: Gzip or Zstd
+ * @param parent: QObject parent for this object
+ */
+
+CompressedDevice::CompressedDevice(QIODevice *dev, Format fmt, QObject *parent) : QIODevice(parent)
+{
+  device = dev;
+  format = fmt;
+  state = nullptr;
+  finished = false;
+  cancelled = false;
+  offset = 0;
+}
+
+
+/**
+ * @brief CompressedDevice::~CompressedDevice
+ *
+ * Close the device, which finishes the compressed stream or stops the
+ * decompressing thread.
+ */
+
+CompressedDevice::~CompressedDevice()
+{
+  if(isOpen())
+    close();
+}
+
+
+/**
+ * @brief CompressedDevice::detect
+ *
+ * Recognize a compressed stream by its magic number, without consuming it.
+ *
+ * @param dev: An open device
+ * @return Returns the format of the data at the current position of dev.
+ */
+
+CompressedDevice::Format CompressedDevice::detect(QIODevice *dev)
+{
+  QByteArray magic = dev->peek(4);
+
+
+  if(magic.startsWith("\x1f\x8b"))
+    return Gzip;
+
+  if(magic == QByteArray("\x28\xb5\x2f\xfd", 4))
+    return Zstd;
+
+  return Plain;
+}
+
+
+/**
+ * @brief CompressedDevice::formatForFile
+ *
+ * @param file: A file name
+ * @return Returns Gzip for names ending in .gz, Zstd for .zst, Plain otherwise.
+ */
+
+CompressedDevice::Format CompressedDevice::formatForFile(const QString &file)
+{
+  if(file.endsWith(".gz", Qt::CaseInsensitive))
+    return Gzip;
+
+  if(file.endsWith(".zst", Qt::CaseInsensitive))
+    return Zstd;
+
+  return Plain;
+}
+
+
+/**
+ * @brief CompressedDevice::isSupported
+ *
+ * @return Returns false for Zstd when the program is built without zstd.
+ */
+
+bool CompressedDevice::isSupported(Format format)
+{
+#ifdef QJTREE_ZSTD
+  Q_UNUSED(format)
+  return true;
+#else
+  return format != Zstd;
+#endif
+}
+
+
+/**
+ * @brief CompressedDevice::open
+ *
+ * Open for reading, which starts the decompressing thread, or for writing.
+ *
+ * @param mode: ReadOnly or WriteOnly
+ * @return Returns false for other modes, unsupported formats, or if the
+ * compression library cannot be initialized.
+ */
+
+bool CompressedDevice::open(OpenMode mode)
+{
+  bool reading = (mode & ReadWrite) == ReadOnly;
+  bool writing = (mode & ReadWrite) == WriteOnly;
+  int rc = Z_OK;
+
+
+  if((!reading && !writing) || format == Plain || !isSupported(format)) {
+      setErrorString("Unsupported compression or open mode");
+      return false;
+  }
+
+  state = new CompressionState;
+
+  if(format == Gzip) {
+      if(reading)
+        rc = inflateInit2(&state->zs, 15 + 32);   // gzip or zlib header
+      else
+        rc = deflateInit2(&state->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  }
+#ifdef QJTREE_ZSTD
+  else {
+      if(reading) {
+          state->dstream = ZSTD_createDStream();
+          rc = state->dstream == nullptr ? Z_MEM_ERROR : Z_OK;
+      }
+      else {
+          state->cstream = ZSTD_createCStream();
+          rc = state->cstream == nullptr ? Z_MEM_ERROR : Z_OK;
+      }
+  }
+#endif
+
+  if(rc != Z_OK) {
+      delete state;
+      state = nullptr;
+      setErrorString("Cannot initialize the compression library");
+      return false;
+  }
+
+  QIODevice::open(mode);
+
+  if(reading) {
+      chunks.clear();
+      current.clear();
+      offset = 0;
+      finished = false;
+      cancelled = false;
+      failure.clear();
+      worker = QtConcurrent::run([this]() { decompress(); });
+  }
+
+  return true;
+}
+
+
+/**
+ * @brief CompressedDevice::close
+ *
+ * When writing, finish the compressed stream. When reading, stop the
+ * decompressing thread if the reader did not read everything.
+ */
+
+void CompressedDevice::close()
+{
+  if(!isOpen())
+    return;
+
+  if(openMode() & WriteOnly)
+    compress(nullptr, 0, true);
+  else
+    stopWorker();
+
+  if(format == Gzip) {
+      if(openMode() & WriteOnly)
+        deflateEnd(&state->zs);
+      else
+        inflateEnd(&state->zs);
+  }
+#ifdef QJTREE_ZSTD
+  else {
+      ZSTD_freeDStream(state->dstream);
+      ZSTD_freeCStream(state->cstream);
+  }
+#endif
+
+  delete state;
+  state = nullptr;
+  QIODevice::close();
+}
+
+
+/**
+ * @brief CompressedDevice::isSequential
+ * @return Returns true; the device cannot seek.
+ */
+
+bool CompressedDevice::isSequential() const
+{
+  return true;
+}
+
+
+/**
+ * @brief CompressedDevice::stopWorker
+ *
+ * Tell the decompressing thread to stop, and wait for it.
+ */
+
+void CompressedDevice::stopWorker()
+{
+  mutex.lock();
+  cancelled = true;
+  chunkTaken.wakeAll();
+  mutex.unlock();
+
+  worker.waitForFinished();
+}
+
+
+/**
+ * @brief CompressedDevice::pushChunk
+ *
+ * Called by the decompressing thread: queue a block of decompressed data,
+ * waiting while the reader is QueueLength blocks behind.
+ *
+ * @return Returns false if the device is being closed.
+ */
+
+bool CompressedDevice::pushChunk(const QByteArray &chunk)
+{
+  QMutexLocker locker(&mutex);
+
+
+  while(chunks.count() >= QueueLength && !cancelled)
+    chunkTaken.wait(&mutex);
+
+  if(cancelled)
+    return false;
+
+  chunks.enqueue(chunk);
+  chunkReady.wakeOne();
+  return true;
+}
+
+
+/**
+ * @brief CompressedDevice::decompress
+ *
+ * Body of the decompressing thread: read compressed blocks from the
+ * underlying device and queue the decompressed data until the end of the
+ * stream. Concatenated gzip members and zstd frames are read one after the other.
+ */
+
+void CompressedDevice::decompress()
+{
+  QByteArray in(InputChunk, Qt::Uninitialized);
+  QByteArray out;
+  QString error;
+  bool complete = false;
+  bool stop = false;
+
+
+  while(!stop) {
+      qint64 n = device->read(in.data(), in.size());
+      if(n < 0) {
+          error = device->errorString();
+          break;
+      }
+      if(n == 0)
+        break;
+
+      if(format == Gzip) {
+          z_stream &zs = state->zs;
+          zs.next_in = reinterpret_cast<Bytef *>(in.data());
+          zs.avail_in = uInt(n);
+
+          // Output may be pending even when all input is consumed, while the output block fills up.
+          do {
+              out.resize(OutputChunk);
+              zs.next_out = reinterpret_cast<Bytef *>(out.data());
+              zs.avail_out = uInt(out.size());
+
+              int rc = inflate(&zs, Z_NO_FLUSH);
+              complete = (rc == Z_STREAM_END);
+              if(rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                  error = QString("gzip: %1").arg(zs.msg != nullptr ? zs.msg : "corrupt stream");
+                  stop = true;
+                  break;
+              }
+
+              out.resize(OutputChunk - int(zs.avail_out));
+              if(!out.isEmpty() && !pushChunk(out))
+                stop = true;
+
+              if(complete && zs.avail_in > 0)
+                inflateReset(&zs);
+          } while((zs.avail_in > 0 || zs.avail_out == 0) && !stop);
+      }
+#ifdef QJTREE_ZSTD
+      else {
+          ZSTD_inBuffer input = {in.constData(), size_t(n), 0};
+          bool full;
+
+          do {
+              out.resize(OutputChunk);
+              ZSTD_outBuffer output = {out.data(), size_t(out.size()), 0};
+
+              size_t rc = ZSTD_decompressStream(state->dstream, &output, &input);
+              if(ZSTD_isError(rc)) {
+                  error = QString("zstd: %1").arg(ZSTD_getErrorName(rc));
+                  stop = true;
+                  break;
+              }
+              complete = (rc == 0);
+              full = (output.pos == output.size);
+
+              out.resize(int(output.pos));
+              if(!out.isEmpty() && !pushChunk(out))
+                stop = true;
+          } while((input.pos < input.size || full) && !stop);
+      }
+#endif
+  }
+
+  if(!complete && error.isEmpty())
+    error = QString("Unexpected end of compressed data");
+
+  QMutexLocker locker(&mutex);
+  if(!cancelled)
+    failure = error;
+  finished = true;
+  chunkReady.wakeAll();
+}
+
+
+/**
+ * @brief CompressedDevice::readData
+ *
+ * Copy decompressed data to the reader, waiting for the decompressing
+ * thread only when nothing is queued.
+ *
+ * @return Returns the number of bytes read; -1 at the end of the stream or on error.
+ */
+
+qint64 CompressedDevice::readData(char *data, qint64 maxSize)
+{
+  qint64 total = 0;
+
+
+  while(total < maxSize) {
+      if(offset >= current.size()) {
+          QMutexLocker locker(&mutex);
+
+          while(chunks.isEmpty() && !finished && total == 0)
+            chunkReady.wait(&mutex);
+
+          if(chunks.isEmpty()) {
+              if(total == 0 && finished && !failure.isEmpty())
+                setErrorString(failure);
+              break;
+          }
+
+          current = chunks.dequeue();
+          offset = 0;
+          chunkTaken.wakeOne();
+      }
+
+      int n = int(qMin(maxSize - total, qint64(current.size() - offset)));
+      std::memcpy(data + total, current.constData() + offset, size_t(n));
+      offset += n;
+      total += n;
+  }
+
+  return total > 0 ? total : -1;
+}
+
+
+/**
+ * @brief CompressedDevice::compress
+ *
+ * Compress a block of data and write the result to the underlying device.
+ *
+ * @param data: The data
+ * @param size: Its size
+ * @param end: True to finish the stream
+ * @return Returns false if the underlying device could not be written.
+ */
+
+bool CompressedDevice::compress(const char *data, qint64 size, bool end)
+{
+  QByteArray out(InputChunk, Qt::Uninitialized);
+
+
+  if(format == Gzip) {
+      z_stream &zs = state->zs;
+      int rc;
+
+      zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+      zs.avail_in = uInt(size);
+      do {
+          zs.next_out = reinterpret_cast<Bytef *>(out.data());
+          zs.avail_out = uInt(out.size());
+
+          rc = deflate(&zs, end ? Z_FINISH : Z_NO_FLUSH);
+          if(rc == Z_STREAM_ERROR)
+            return false;
+
+          qint64 produced = out.size() - qint64(zs.avail_out);
+          if(produced > 0 && device->write(out.constData(), produced) != produced)
+            return false;
+      } while(zs.avail_out == 0 && rc != Z_STREAM_END);
+  }
+#ifdef QJTREE_ZSTD
+  else {
+      ZSTD_inBuffer input = {data, size_t(size), 0};
+      size_t remaining;
+
+      do {
+          ZSTD_outBuffer output = {out.data(), size_t(out.size()), 0};
+
+          remaining = ZSTD_compressStream2(state->cstream, &output, &input, end ? ZSTD_e_end : ZSTD_e_continue);
+          if(ZSTD_isError(remaining))
+            return false;
+
+          if(output.pos > 0 && device->write(out.constData(), qint64(output.pos)) != qint64(output.pos))
+            return false;
+      } while(input.pos < input.size || (end && remaining > 0));
+  }
+#endif
+
+  return true;
+}
+
+
+/**
+ * @brief CompressedDevice::writeData
+ *
+ * Compress the data and write it to the underlying device.
+ *
+ * @return Returns size, or -1 if the underlying device could not be written.
+ */
+
+qint64 CompressedDevice::writeData(const char *data, qint64 maxSize)
+{
+  if(!compress(data, maxSize, false)) {
+      setErrorString(device->errorString());
+      return -1;
+  }
+
+  return maxSize;
+}
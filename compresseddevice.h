@@ -0,0 +1,103 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFuture>
+
+
+struct CompressionState;
+
+
+/**
+ * @brief The CompressedDevice class
+ *
+ * Sequential QIODevice that decompresses a gzip or zstd stream read from
+ * another device, or compresses the data written to it into another device.
+ *
+ * When reading, decompression runs on a worker thread, which hands chunks of
+ * decompressed data to the reading thread through a short queue: a parser
+ * reading from the device works while the next chunks are decompressed, and
+ * at most a few chunks of decompressed data are held in memory.
+ *
+ * zstd support is compiled in with CONFIG += zstd (see qjtree.pro).
+ */
+class CompressedDevice : public QIODevice
+{
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Formats read and written by the device.
+   */
+  enum Format {
+    Plain,  /**< Not compressed */
+    Gzip,   /**< gzip (or zlib) stream */
+    Zstd    /**< Zstandard stream */
+  };
+
+  static Format detect(QIODevice *dev);
+  static Format formatForFile(const QString &file);
+  static bool isSupported(Format format);
+
+  CompressedDevice(QIODevice *dev, Format format, QObject *parent = nullptr);
+  virtual ~CompressedDevice() override;
+
+  bool open(OpenMode mode) override;
+  void close() override;
+  bool isSequential() const override;
+
+protected:
+  qint64 readData(char *data, qint64 maxSize) override;
+  qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+  QIODevice         *device;
+  Format             format;
+  CompressionState  *state;
+
+  // Hand-off between the decompressing thread and the reader.
+  QMutex             mutex;
+  QWaitCondition     chunkReady;
+  QWaitCondition     chunkTaken;
+  QQueue<QByteArray> chunks;
+  bool               finished;
+  bool               cancelled;
+  QString            failure;
+  QFuture<void>      worker;
+
+  QByteArray         current;
+  int                offset;
+
+  void decompress();
+  bool pushChunk(const QByteArray &chunk);
+  bool compress(const char *data, qint64 size, bool end);
+  void stopWorker();
+};
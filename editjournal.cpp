@@ -0,0 +1,346 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QtConcurrent>
+#include "editjournal.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief Milliseconds between writing the buffered records and the fsync
+ * that makes them durable.
+ */
+static const int SyncInterval = 100;
+
+/**
+ * @brief First item of the header line of a journal.
+ */
+static const char *JournalMagic = "qjtree-journal";
+
+
+/**
+ * @brief syncDescriptor
+ *
+ * Wait until the data written to a file descriptor is on the disk.
+ *
+ * @param fd: The descriptor
+ * @return Returns false on error.
+ */
+
+static bool syncDescriptor(int fd)
+{
+#ifdef Q_OS_WIN
+  return _commit(fd) == 0;
+#else
+  return fsync(fd) == 0;
+#endif
+}
+
+
+/**
+ * @brief EditJournal::EditJournal
+ * @param parent: QObject parent
+ */
+
+EditJournal::EditJournal(QObject *parent) : QObject(parent), syncRunning(false), syncAgain(false)
+{
+  timer.setSingleShot(true);
+  timer.setInterval(SyncInterval);
+  connect(&timer, &QTimer::timeout, this, &EditJournal::write);
+  connect(&syncing, &QFutureWatcher<void>::finished, this, &EditJournal::syncFinished);
+}
+
+
+/**
+ * @brief EditJournal::~EditJournal
+ *
+ * Stop journaling; see stop().
+ */
+
+EditJournal::~EditJournal()
+{
+  stop();
+}
+
+
+/**
+ * @brief EditJournal::fileFor
+ * @param document: Name of a document file
+ * @return Returns the name of its journal.
+ */
+
+QString EditJournal::fileFor(const QString &document)
+{
+  return document + ".journal";
+}
+
+
+/**
+ * @brief EditJournal::header
+ * @param document: Name of a document file
+ * @return Returns the header line of a journal of the file as it is now.
+ */
+
+QJsonArray EditJournal::header(const QString &document)
+{
+  QFileInfo info(document);
+
+
+  return QJsonArray{QString(JournalMagic), 1, double(info.size()), double(info.lastModified().toMSecsSinceEpoch())};
+}
+
+
+/**
+ * @brief EditJournal::canRecover
+ * @param document: Name of a document file
+ * @return Returns true if a journal of the file holds edits, and the file
+ * was not changed since the journal was started.
+ */
+
+bool EditJournal::canRecover(const QString &document)
+{
+  QFile journal(fileFor(document));
+
+
+  if(!journal.open(QIODevice::ReadOnly))
+    return false;
+
+  QJsonDocument first = QJsonDocument::fromJson(journal.readLine());
+  return first.array() == header(document) && !journal.atEnd();
+}
+
+
+/**
+ * @brief EditJournal::records
+ *
+ * Read the edits recorded in the journal of a file. Reading stops at the
+ * first line that is incomplete or damaged, which is where the session
+ * crashed.
+ *
+ * @param document: Name of the document file
+ * @param error: Receives the reason if there are no records to replay
+ * @return Returns the records, in the order of the edits.
+ */
+
+QVector<QJsonArray> EditJournal::records(const QString &document, QString *error)
+{
+  QFile journal(fileFor(document));
+  QVector<QJsonArray> list;
+
+
+  if(!journal.open(QIODevice::ReadOnly)) {
+      *error = journal.errorString();
+      return list;
+  }
+
+  if(QJsonDocument::fromJson(journal.readLine()).array() != header(document)) {
+      *error = QString("The journal was written for another version of the file");
+      return list;
+  }
+
+  while(!journal.atEnd()) {
+      QByteArray line = journal.readLine();
+      QJsonParseError err;
+
+      if(!line.endsWith('\n'))
+        break;
+
+      QJsonDocument record = QJsonDocument::fromJson(line, &err);
+      if(err.error != QJsonParseError::NoError || !record.isArray())
+        break;
+      list.append(record.array());
+  }
+
+  return list;
+}
+
+
+/**
+ * @brief EditJournal::start
+ *
+ * Start a new, empty journal for a file, replacing the journal this object
+ * kept so far.
+ *
+ * @param document: Name of the document file, as it is on the disk now
+ * @param error: Receives the reason if the journal cannot be written
+ * @return Returns true if the journal was started.
+ */
+
+bool EditJournal::start(const QString &document, QString *error)
+{
+  stop();
+
+  file.setFileName(fileFor(document));
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      *error = file.errorString();
+      return false;
+  }
+
+  file.write(QJsonDocument(header(document)).toJson(QJsonDocument::Compact) + '\n');
+  file.flush();
+  syncDescriptor(file.handle());
+  return true;
+}
+
+
+/**
+ * @brief EditJournal::stop
+ *
+ * Write and sync the pending records, then close and delete the journal.
+ * Called when the edits are saved, or deliberately discarded.
+ */
+
+void EditJournal::stop()
+{
+  if(!isActive())
+    return;
+
+  sync();
+  file.close();
+  file.remove();
+}
+
+
+/**
+ * @brief EditJournal::isActive
+ * @return Returns true while edits are recorded.
+ */
+
+bool EditJournal::isActive() const
+{
+  return file.isOpen();
+}
+
+
+/**
+ * @brief EditJournal::append
+ *
+ * Record an edit. The record is written with the others of the same
+ * SyncInterval.
+ *
+ * @param record: The edit
+ */
+
+void EditJournal::append(const QJsonArray &record)
+{
+  if(!isActive())
+    return;
+
+  pending += QJsonDocument(record).toJson(QJsonDocument::Compact);
+  pending += '\n';
+  if(!timer.isActive())
+    timer.start();
+}
+
+
+/**
+ * @brief EditJournal::sync
+ *
+ * Write the pending records and wait until all records are on the disk.
+ */
+
+void EditJournal::sync()
+{
+  if(!isActive())
+    return;
+
+  timer.stop();
+  if(!pending.isEmpty()) {
+      file.write(pending);
+      file.flush();
+      pending.clear();
+  }
+
+  syncing.waitForFinished();
+  syncRunning = false;
+  syncAgain = false;
+  syncDescriptor(file.handle());
+}
+
+
+/**
+ * @brief EditJournal::write
+ *
+ * Hand the pending records to the operating system, and have them synced
+ * to the disk on a worker thread.
+ */
+
+void EditJournal::write()
+{
+  if(pending.isEmpty() || !isActive())
+    return;
+
+  file.write(pending);
+  file.flush();
+  pending.clear();
+  startSync();
+}
+
+
+/**
+ * @brief EditJournal::startSync
+ *
+ * Start an fsync on a worker thread. If one is running, another is started
+ * when it finishes, so records written meanwhile are covered too; one fsync
+ * covers all the records written before it.
+ */
+
+void EditJournal::startSync()
+{
+  int fd = file.handle();
+
+
+  if(syncRunning) {
+      syncAgain = true;
+      return;
+  }
+
+  syncRunning = true;
+  syncing.setFuture(QtConcurrent::run([fd]() { syncDescriptor(fd); }));
+}
+
+
+/**
+ * @brief EditJournal::syncFinished
+ *
+ * Start the next fsync if records were written during the last one.
+ */
+
+void EditJournal::syncFinished()
+{
+  syncRunning = false;
+  if(syncAgain && isActive()) {
+      syncAgain = false;
+      startSync();
+  }
+}
@@ -0,0 +1,85 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QObject>
+#include <QFile>
+#include <QByteArray>
+#include <QJsonArray>
+#include <QVector>
+#include <QTimer>
+#include <QFutureWatcher>
+
+
+/**
+ * @brief The EditJournal class
+ *
+ * Append-only log of the edits of a document, kept next to its file as
+ * "<file>.journal", so that the edits of a session that crashed can be
+ * replayed on the file instead of being lost. The file is only rewritten
+ * when the document is saved; the journal then starts again.
+ *
+ * The first line identifies the document file by its size and modification
+ * time; each following line is one edit, as a compact JSON array (see
+ * JsonTreeModel::recoverJournal()). A line that was only partly written when
+ * the session crashed is ignored.
+ *
+ * append() only adds the record to a buffer. The buffer is written once per
+ * SyncInterval, and the written records are then made durable with one
+ * fsync on a worker thread, so an edit costs no disk access at all; a crash
+ * loses at most the edits of the last interval.
+ */
+class EditJournal : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit EditJournal(QObject *parent = nullptr);
+  virtual ~EditJournal() override;
+
+  static QString fileFor(const QString &document);
+  static bool canRecover(const QString &document);
+  static QVector<QJsonArray> records(const QString &document, QString *error);
+
+  bool start(const QString &document, QString *error);
+  void stop();
+  bool isActive() const;
+  void append(const QJsonArray &record);
+  void sync();
+
+private:
+  QFile                 file;     /**< The journal file */
+  QByteArray            pending;  /**< Records not written yet */
+  QTimer                timer;    /**< Writes the pending records */
+  QFutureWatcher<void>  syncing;  /**< The fsync in progress */
+  bool                  syncRunning; /**< True while syncing runs */
+  bool                  syncAgain; /**< Records were written during that fsync */
+
+  static QJsonArray header(const QString &document);
+  void write();
+  void startSync();
+  void syncFinished();
+};
@@ -0,0 +1,414 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <cstring>
+#include <QJsonArray>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include "jsonpointer.h"
+#include "jsonstream.h"
+
+
+/**
+ * @brief JsonPointer::tokens
+ *
+ * Split a JSON Pointer into its reference tokens, replacing the escapes ~1
+ * and ~0 by '/' and '~'. The empty pointer refers to the whole document.
+ *
+ * @param pointer: The pointer, e.g. "/a~1b/0"
+ * @param list: Receives the tokens, e.g. "a/b", "0"
+ * @return Returns false if the pointer is not valid.
+ */
+
+bool JsonPointer::tokens(const QString &pointer, QStringList *list)
+{
+  list->clear();
+  if(pointer.isEmpty())
+    return true;
+
+  if(!pointer.startsWith('/'))
+    return false;
+
+  for(QString token : pointer.mid(1).split('/')) {
+      for(int i = token.indexOf('~'); i >= 0; i = token.indexOf('~', i + 1))
+        if(i + 1 >= token.size() || (token[i + 1] != '0' && token[i + 1] != '1'))
+          return false;
+
+      token.replace("~1", "/");
+      token.replace("~0", "~");
+      list->append(token);
+  }
+
+  return true;
+}
+
+
+/**
+ * @brief JsonPointer::fromTokens
+ * @param list: Reference tokens
+ * @return Returns the JSON Pointer made of the tokens.
+ */
+
+QString JsonPointer::fromTokens(const QStringList &list)
+{
+  QString pointer;
+
+
+  for(QString token : list) {
+      token.replace("~", "~0");
+      token.replace("/", "~1");
+      pointer += '/' + token;
+  }
+
+  return pointer;
+}
+
+
+/**
+ * @brief JsonPointer::append
+ * @param pointer: A JSON Pointer
+ * @param token: A reference token
+ * @return Returns the pointer to the member or item token of the value of pointer.
+ */
+
+QString JsonPointer::append(const QString &pointer, const QString &token)
+{
+  if(!token.contains('~') && !token.contains('/'))
+    return pointer + '/' + token;
+
+  return pointer + fromTokens(QStringList(token));
+}
+
+
+/**
+ * @brief JsonPointer::arrayIndex
+ *
+ * Read a reference token as an array index: decimal digits only, without
+ * a sign or leading zeros, so "/01" and "/+1" do not refer to item 1.
+ *
+ * @param token: A reference token
+ * @param index: Receives the index
+ * @return Returns false if the token is not an array index.
+ */
+
+bool JsonPointer::arrayIndex(const QString &token, int *index)
+{
+  bool digits = !token.isEmpty() && (token == "0" || !token.startsWith('0'));
+  bool ok;
+
+
+  for(int i = 0; digits && i < token.size(); i++)
+    digits = token[i].unicode() >= '0' && token[i].unicode() <= '9';
+
+  *index = token.toInt(&ok);
+  return digits && ok;
+}
+
+
+/**
+ * @brief matchByte
+ *
+ * Test the eight bytes of a word for one value at once.
+ *
+ * @return Returns a word with the high bit set in the bytes of word that
+ * equal c. Bits above the first match may be set wrongly, so only the
+ * lowest set bit is meaningful.
+ */
+
+static inline quint64 matchByte(quint64 word, char c)
+{
+  const quint64 ones = Q_UINT64_C(0x0101010101010101);
+  quint64 x = word ^ (ones * uchar(c));
+
+
+  return (x - ones) & ~x & Q_UINT64_C(0x8080808080808080);
+}
+
+
+/**
+ * @brief JsonSkipScanner::JsonSkipScanner
+ * @param text: The document text, e.g. a mapped file; must stay valid while the scanner is used
+ * @param length: Its length
+ */
+
+JsonSkipScanner::JsonSkipScanner(const char *text, qint64 length) : data(text), size(length)
+{
+}
+
+
+/**
+ * @brief JsonSkipScanner::skipSpace
+ * @return Returns the position of the first byte at or after pos that is not white space.
+ */
+
+qint64 JsonSkipScanner::skipSpace(qint64 pos) const
+{
+  while(pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'))
+    pos++;
+
+  return pos;
+}
+
+
+/**
+ * @brief JsonSkipScanner::stringEnd
+ *
+ * Find the end of a string. The closing quote is searched with memchr(),
+ * which the C library vectorizes; a quote preceded by an odd number of
+ * backslashes is escaped.
+ *
+ * @param pos: Position of the opening quote
+ * @return Returns the position after the closing quote; -1 if there is none.
+ */
+
+qint64 JsonSkipScanner::stringEnd(qint64 pos) const
+{
+  qint64 i = pos + 1;
+
+
+  while(i < size) {
+      const char *quote = static_cast<const char *>(memchr(data + i, '"', size_t(size - i)));
+      if(quote == nullptr)
+        return -1;
+
+      qint64 q = quote - data;
+      qint64 backslashes = 0;
+      while(q - 1 - backslashes > pos && data[q - 1 - backslashes] == '\\')
+        backslashes++;
+
+      if(backslashes % 2 == 0)
+        return q + 1;
+      i = q + 1;
+  }
+
+  return -1;
+}
+
+
+/**
+ * @brief JsonSkipScanner::containerEnd
+ *
+ * Find the end of an object or array by bracket matching. Bytes are tested
+ * eight at a time for quotes and brackets; strings are skipped whole, so
+ * brackets inside them are not counted.
+ *
+ * @param pos: Position of the opening bracket
+ * @return Returns the position after the closing bracket; the end of the
+ * text if it is not closed.
+ */
+
+qint64 JsonSkipScanner::containerEnd(qint64 pos) const
+{
+  qint64 i = pos;
+  int depth = 0;
+
+
+  while(i < size) {
+      while(i + 8 <= size) {
+          quint64 word;
+          memcpy(&word, data + i, sizeof(word));
+          word = qFromLittleEndian(word);
+
+          quint64 hits = matchByte(word, '"') | matchByte(word, '{') | matchByte(word, '}') |
+                         matchByte(word, '[') | matchByte(word, ']');
+          if(hits != 0) {
+              i += qCountTrailingZeroBits(hits) / 8;
+              break;
+          }
+          i += 8;
+      }
+
+      if(i >= size)
+        break;
+
+      char c = data[i];
+      if(c == '"') {
+          i = stringEnd(i);
+          if(i < 0)
+            return size;
+          continue;
+      }
+
+      if(c == '{' || c == '[') {
+          depth++;
+      }
+      else if(c == '}' || c == ']') {
+          if(--depth == 0)
+            return i + 1;
+      }
+      i++;
+  }
+
+  return size;
+}
+
+
+/**
+ * @brief JsonSkipScanner::valueEnd
+ * @param pos: Position of the first byte of a value
+ * @return Returns the position after the value; the end of the text if the
+ * value is not terminated.
+ */
+
+qint64 JsonSkipScanner::valueEnd(qint64 pos) const
+{
+  if(pos >= size)
+    return size;
+
+  switch(data[pos]) {
+
+    case '"': {
+      qint64 end = stringEnd(pos);
+      return end < 0 ? size : end;
+    }
+
+    case '{':
+    case '[':
+      return containerEnd(pos);
+
+    default:
+      while(pos < size && data[pos] != ',' && data[pos] != '}' && data[pos] != ']' &&
+            data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\n' && data[pos] != '\r')
+        pos++;
+      return pos;
+  }
+}
+
+
+/**
+ * @brief JsonSkipScanner::keyEquals
+ *
+ * Compare an object key with a reference token. Keys without escapes are
+ * compared as bytes; others are decoded first.
+ *
+ * @param begin: Position of the first byte of the key, after the quote
+ * @param end: Position of the closing quote
+ * @param key: The token, as UTF-8
+ */
+
+bool JsonSkipScanner::keyEquals(qint64 begin, qint64 end, const QByteArray &key) const
+{
+  if(memchr(data + begin, '\\', size_t(end - begin)) == nullptr)
+    return end - begin == key.size() && memcmp(data + begin, key.constData(), size_t(key.size())) == 0;
+
+  QByteArray text = QByteArray("[") + QByteArray(data + begin - 1, int(end - begin + 2)) + ']';
+  JsonStreamReader reader(text.constData(), text.size());
+  QJsonParseError err;
+
+
+  return reader.read(&err).toArray().at(0).toString() == QString::fromUtf8(key);
+}
+
+
+/**
+ * @brief JsonSkipScanner::seek
+ *
+ * Walk from the top-level value to the value a JSON Pointer refers to.
+ * In each object or array on the way, the members before the one on the path
+ * are skipped with valueEnd(), and the scan stops as soon as it is found; the
+ * rest of the document is not read. Of duplicate keys, the first is taken.
+ *
+ * @param tokens: Reference tokens of the pointer; see JsonPointer::tokens()
+ * @param offsets: Receives the position of the top-level value, then of the
+ * value of each token; the last one is the target
+ * @param err: Receives MissingObject with the position of the container
+ * if a token is not found
+ * @return Returns false if the value does not exist.
+ */
+
+bool JsonSkipScanner::seek(const QStringList &tokens, QVector<qint64> *offsets, QJsonParseError *err) const
+{
+  qint64 pos = skipSpace(0);
+
+
+  offsets->clear();
+  offsets->append(pos);
+  err->error = QJsonParseError::NoError;
+  err->offset = 0;
+
+  for(const QString &token : tokens) {
+      char c = (pos < size) ? data[pos] : '\0';
+      bool found = false;
+
+      if(c == '{') {
+          QByteArray key = token.toUtf8();
+
+          pos = skipSpace(pos + 1);
+          while(pos < size && data[pos] == '"') {
+              qint64 keyEnd = stringEnd(pos);
+              if(keyEnd < 0) {
+                  pos = size;
+                  break;
+              }
+
+              bool match = keyEquals(pos + 1, keyEnd - 1, key);
+              pos = skipSpace(keyEnd);
+              if(pos >= size || data[pos] != ':')
+                break;
+
+              pos = skipSpace(pos + 1);
+              if(match) {
+                  found = true;
+                  break;
+              }
+
+              pos = skipSpace(valueEnd(pos));
+              if(pos >= size || data[pos] != ',')
+                break;
+              pos = skipSpace(pos + 1);
+          }
+      }
+      else if(c == '[') {
+          int index;
+          bool ok = JsonPointer::arrayIndex(token, &index);
+
+          pos = skipSpace(pos + 1);
+          for(int i = 0; ok && index >= 0 && pos < size && data[pos] != ']'; i++) {
+              if(i == index) {
+                  found = true;
+                  break;
+              }
+
+              pos = skipSpace(valueEnd(pos));
+              if(pos >= size || data[pos] != ',')
+                break;
+              pos = skipSpace(pos + 1);
+          }
+      }
+
+      if(!found) {
+          if(pos >= size)
+            err->error = (c == '{') ? QJsonParseError::UnterminatedObject : QJsonParseError::UnterminatedArray;
+          else
+            err->error = QJsonParseError::MissingObject;
+          err->offset = parseErrorOffset(offsets->last());
+          return false;
+      }
+
+      offsets->append(pos);
+  }
+
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QJsonParseError>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/**
+ * @brief The JsonPointer class
+ *
+ * Conversion of JSON Pointers (RFC 6901), such as "/store/books/3/title",
+ * to and from their reference tokens.
+ */
+class JsonPointer
+{
+public:
+  static bool tokens(const QString &pointer, QStringList *list);
+  static QString fromTokens(const QStringList &list);
+  static QString append(const QString &pointer, const QString &token);
+  static bool arrayIndex(const QString &token, int *index);
+};
+
+
+/**
+ * @brief The JsonSkipScanner class
+ *
+ * Finds a value in JSON text by its JSON Pointer without parsing the rest of
+ * the document. Members and items that are not on the path are skipped by
+ * bracket matching: only strings and brackets are looked at, and the bytes in
+ * between are tested eight at a time. The time taken depends on the bytes
+ * scanned, not on the number of values.
+ */
+class JsonSkipScanner
+{
+public:
+  JsonSkipScanner(const char *text, qint64 length);
+
+  bool seek(const QStringList &tokens, QVector<qint64> *offsets, QJsonParseError *err) const;
+  qint64 valueEnd(qint64 pos) const;
+
+private:
+  const char  *data;  /**< The document text */
+  qint64       size;  /**< Its length */
+
+  qint64 skipSpace(qint64 pos) const;
+  qint64 stringEnd(qint64 pos) const;
+  qint64 containerEnd(qint64 pos) const;
+  bool keyEquals(qint64 begin, qint64 end, const QByteArray &key) const;
+};
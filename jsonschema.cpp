@@ -0,0 +1,864 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include "jsonschema.h"
+#include "jsonpointer.h"
+
+
+/**
+ * @brief SchemaRule::SchemaRule
+ *
+ * Create the rule of the empty schema, which accepts every value.
+ */
+
+SchemaRule::SchemaRule() : never(false), types(JsonSchema::AnyType), hasEnum(false), hasConst(false),
+  minimum(-std::numeric_limits<double>::infinity()), maximum(std::numeric_limits<double>::infinity()),
+  exclusiveMinimum(-std::numeric_limits<double>::infinity()), exclusiveMaximum(std::numeric_limits<double>::infinity()),
+  multipleOf(0), minLength(0), maxLength(-1), minItems(0), maxItems(-1), uniqueItems(false), items(-1), contains(-1),
+  minProperties(0), maxProperties(-1), additionalProperties(-1), notRule(-1), ifRule(-1), thenRule(-1), elseRule(-1), ref(-1)
+{
+}
+
+
+/**
+ * @brief SchemaViolations::applyTo
+ *
+ * Merge the result of a validation run into the results held so far.
+ *
+ * @param results: Messages by JSON Pointer, as kept by the model
+ */
+
+void SchemaViolations::applyTo(QMap<QString, QStringList> *results) const
+{
+  if(full) {
+      *results = found;
+      return;
+  }
+
+  for(const QString &pointer : ancestors)
+    results->remove(pointer);
+
+  // The pointers below a value are sorted right after it.
+  for(const QString &pointer : subtrees) {
+      QString below = pointer + '/';
+      results->remove(pointer);
+      auto it = results->lowerBound(below);
+      while(it != results->end() && it.key().startsWith(below))
+        it = results->erase(it);
+  }
+
+  for(auto it = found.constBegin(); it != found.constEnd(); ++it)
+    (*results)[it.key()] += it.value();
+}
+
+
+/**
+ * @brief The SchemaCompiler class
+ *
+ * Translates the JSON of a schema into SchemaRules. Every subschema is
+ * compiled once, by its location in the schema document, so "$ref"s to the
+ * same definition share a rule and recursive definitions terminate.
+ */
+class SchemaCompiler
+{
+public:
+  SchemaCompiler(const QJsonValue &schema, QVector<SchemaRule> *out) : root(schema), rules(out) {}
+
+  int compile(const QJsonValue &schema, const QString &location);
+  void rejectCycles();
+
+  QString error;  /**< The first error found; empty if there is none */
+
+private:
+  QJsonValue           root;        /**< The schema document */
+  QVector<SchemaRule> *rules;       /**< The compiled rules */
+  QHash<QString, int>  byLocation;  /**< Rule of each compiled location */
+
+  int resolve(const QString &ref, const QString &location);
+  QRegularExpression regex(const QString &pattern, const QString &location);
+  QVector<int> compileList(const QJsonValue &list, const QString &location);
+  bool cycle(int rule, QVector<int> *state);
+};
+
+
+/**
+ * @brief SchemaCompiler::compile
+ * @param schema: An object or boolean schema
+ * @param location: Its JSON Pointer in the schema document
+ * @return Returns the index of its rule; -1 on error.
+ */
+
+int SchemaCompiler::compile(const QJsonValue &schema, const QString &location)
+{
+  if(byLocation.contains(location))
+    return byLocation.value(location);
+
+  int index = rules->count();
+  SchemaRule rule;
+
+
+  rules->append(rule);
+  byLocation.insert(location, index);
+
+  if(schema.isBool()) {
+      rule.never = !schema.toBool();
+      (*rules)[index] = rule;
+      return index;
+  }
+
+  if(!schema.isObject()) {
+      if(error.isEmpty())
+        error = QString("The schema at \"%1\" is not an object").arg(location);
+      return -1;
+  }
+
+  QJsonObject jobj = schema.toObject();
+  auto sub = [&location](const QString &keyword) { return JsonPointer::append(location, keyword); };
+
+  if(jobj.contains("$ref"))
+    rule.ref = resolve(jobj.value("$ref").toString(), sub("$ref"));
+
+  if(jobj.contains("type")) {
+      static const QHash<QString, int> bits{{"null", JsonSchema::NullType}, {"boolean", JsonSchema::BooleanType},
+                                           {"integer", JsonSchema::IntegerType}, {"number", JsonSchema::NumberType},
+                                           {"string", JsonSchema::StringType}, {"array", JsonSchema::ArrayType},
+                                           {"object", JsonSchema::ObjectType}};
+      QJsonValue type = jobj.value("type");
+      QJsonArray names = type.isArray() ? type.toArray() : QJsonArray{type};
+
+      rule.types = 0;
+      for(const QJsonValue &name : names) {
+          if(!bits.contains(name.toString()) && error.isEmpty())
+            error = QString("Unknown type \"%1\" at \"%2\"").arg(name.toString(), sub("type"));
+          rule.types |= bits.value(name.toString());
+      }
+  }
+
+  if(jobj.contains("enum")) {
+      rule.hasEnum = true;
+      rule.enumValues = jobj.value("enum").toArray();
+  }
+  if(jobj.contains("const")) {
+      rule.hasConst = true;
+      rule.constValue = jobj.value("const");
+  }
+
+  rule.minimum = jobj.value("minimum").toDouble(rule.minimum);
+  rule.maximum = jobj.value("maximum").toDouble(rule.maximum);
+  rule.exclusiveMinimum = jobj.value("exclusiveMinimum").toDouble(rule.exclusiveMinimum);
+  rule.exclusiveMaximum = jobj.value("exclusiveMaximum").toDouble(rule.exclusiveMaximum);
+  rule.multipleOf = jobj.value("multipleOf").toDouble(0);
+
+  rule.minLength = jobj.value("minLength").toInt(0);
+  rule.maxLength = jobj.value("maxLength").toInt(-1);
+  if(jobj.contains("pattern"))
+    rule.pattern = regex(jobj.value("pattern").toString(), sub("pattern"));
+
+  rule.minItems = jobj.value("minItems").toInt(0);
+  rule.maxItems = jobj.value("maxItems").toInt(-1);
+  rule.uniqueItems = jobj.value("uniqueItems").toBool(false);
+  if(jobj.value("items").isArray()) {
+      rule.prefixItems = compileList(jobj.value("items"), sub("items"));
+      if(jobj.contains("additionalItems"))
+        rule.items = compile(jobj.value("additionalItems"), sub("additionalItems"));
+  }
+  else {
+      if(jobj.contains("prefixItems"))
+        rule.prefixItems = compileList(jobj.value("prefixItems"), sub("prefixItems"));
+      if(jobj.contains("items"))
+        rule.items = compile(jobj.value("items"), sub("items"));
+  }
+  if(jobj.contains("contains"))
+    rule.contains = compile(jobj.value("contains"), sub("contains"));
+
+  rule.minProperties = jobj.value("minProperties").toInt(0);
+  rule.maxProperties = jobj.value("maxProperties").toInt(-1);
+  for(const QJsonValue &key : jobj.value("required").toArray())
+    rule.required.append(key.toString());
+
+  QJsonObject properties = jobj.value("properties").toObject();
+  for(auto it = properties.constBegin(); it != properties.constEnd(); ++it)
+    rule.properties.insert(it.key(), compile(it.value(), JsonPointer::append(sub("properties"), it.key())));
+
+  QJsonObject patterns = jobj.value("patternProperties").toObject();
+  for(auto it = patterns.constBegin(); it != patterns.constEnd(); ++it) {
+      QString at = JsonPointer::append(sub("patternProperties"), it.key());
+      rule.patternProperties.append(qMakePair(regex(it.key(), at), compile(it.value(), at)));
+  }
+
+  if(jobj.contains("additionalProperties"))
+    rule.additionalProperties = compile(jobj.value("additionalProperties"), sub("additionalProperties"));
+
+  rule.allOf = compileList(jobj.value("allOf"), sub("allOf"));
+  rule.anyOf = compileList(jobj.value("anyOf"), sub("anyOf"));
+  rule.oneOf = compileList(jobj.value("oneOf"), sub("oneOf"));
+  if(jobj.contains("not"))
+    rule.notRule = compile(jobj.value("not"), sub("not"));
+
+  if(jobj.contains("if")) {
+      rule.ifRule = compile(jobj.value("if"), sub("if"));
+      if(jobj.contains("then"))
+        rule.thenRule = compile(jobj.value("then"), sub("then"));
+      if(jobj.contains("else"))
+        rule.elseRule = compile(jobj.value("else"), sub("else"));
+  }
+
+  (*rules)[index] = rule;
+  return index;
+}
+
+
+/**
+ * @brief SchemaCompiler::compileList
+ * @param list: An array of schemas, e.g. of "allOf"; may be undefined
+ * @param location: Its JSON Pointer in the schema document
+ * @return Returns the indices of their rules.
+ */
+
+QVector<int> SchemaCompiler::compileList(const QJsonValue &list, const QString &location)
+{
+  QVector<int> indices;
+  QJsonArray jarr = list.toArray();
+
+
+  for(int i = 0; i < jarr.count(); i++)
+    indices.append(compile(jarr.at(i), JsonPointer::append(location, QString::number(i))));
+
+  return indices;
+}
+
+
+/**
+ * @brief SchemaCompiler::resolve
+ * @param ref: Value of a "$ref", e.g. "#/definitions/address"
+ * @param location: Location of the "$ref" in the schema document
+ * @return Returns the rule of the schema it refers to; -1 on error.
+ */
+
+int SchemaCompiler::resolve(const QString &ref, const QString &location)
+{
+  QStringList tokens;
+  QJsonValue target = root;
+
+
+  if(!ref.startsWith('#') || !JsonPointer::tokens(ref.mid(1), &tokens)) {
+      if(error.isEmpty())
+        error = QString("Only local references are supported (\"%1\" at \"%2\")").arg(ref, location);
+      return -1;
+  }
+
+  for(const QString &token : tokens) {
+      if(target.isObject())
+        target = target.toObject().value(token);
+      else
+        target = target.toArray().at(token.toInt());
+  }
+
+  if(target.isUndefined()) {
+      if(error.isEmpty())
+        error = QString("Cannot resolve \"%1\" at \"%2\"").arg(ref, location);
+      return -1;
+  }
+
+  return compile(target, JsonPointer::fromTokens(tokens));
+}
+
+
+/**
+ * @brief SchemaCompiler::rejectCycles
+ *
+ * Report a schema that refers to itself without descending into the value,
+ * such as {"allOf": [{"$ref": "#"}]}: validating against it would never end.
+ * Cycles through "properties", "items" and the like are fine, since each
+ * step checks a smaller value.
+ */
+
+void SchemaCompiler::rejectCycles()
+{
+  QVector<int> state(rules->count(), 0);
+
+
+  for(int rule = 0; rule < rules->count() && error.isEmpty(); rule++)
+    cycle(rule, &state);
+}
+
+
+/**
+ * @brief SchemaCompiler::cycle
+ *
+ * Depth-first search of the rules that apply to the same value as a rule:
+ * its "$ref", "allOf", "anyOf", "oneOf", "not", "if", "then" and "else".
+ *
+ * @param rule: Index of the rule
+ * @param state: Per rule, 0 if not visited, 1 while on the search path, 2 when done
+ * @return Returns true if a cycle was found; error tells where.
+ */
+
+bool SchemaCompiler::cycle(int rule, QVector<int> *state)
+{
+  if(rule < 0 || (*state)[rule] == 2)
+    return false;
+
+  if((*state)[rule] == 1) {
+      error = QString("The schema at \"%1\" refers to itself without descending into the value")
+              .arg(byLocation.key(rule));
+      return true;
+  }
+
+  const SchemaRule &r = rules->at(rule);
+  QVector<int> next = r.allOf + r.anyOf + r.oneOf;
+
+
+  next << r.ref << r.notRule << r.ifRule << r.thenRule << r.elseRule;
+  (*state)[rule] = 1;
+  for(int sub : next)
+    if(cycle(sub, state))
+      return true;
+
+  (*state)[rule] = 2;
+  return false;
+}
+
+
+/**
+ * @brief SchemaCompiler::regex
+ * @param pattern: A regular expression of the schema
+ * @param location: Its location in the schema document
+ * @return Returns the compiled expression.
+ */
+
+QRegularExpression SchemaCompiler::regex(const QString &pattern, const QString &location)
+{
+  QRegularExpression expression(pattern);
+
+
+  if(!expression.isValid() && error.isEmpty())
+    error = QString("Invalid pattern at \"%1\": %2").arg(location, expression.errorString());
+
+  return expression;
+}
+
+
+/**
+ * @brief JsonSchema::JsonSchema
+ *
+ * Create a null schema.
+ */
+
+JsonSchema::JsonSchema()
+{
+}
+
+
+/**
+ * @brief JsonSchema::JsonSchema
+ *
+ * Compile a schema.
+ *
+ * @param schema: The schema document
+ * @param error: Receives a description of the first error; empty if the
+ * schema was compiled. The schema is null after an error.
+ */
+
+JsonSchema::JsonSchema(const QJsonValue &schema, QString *error)
+{
+  QSharedPointer<QVector<SchemaRule>> compiled = QSharedPointer<QVector<SchemaRule>>::create();
+  SchemaCompiler compiler(schema, compiled.data());
+
+
+  compiler.compile(schema, QString());
+  if(compiler.error.isEmpty())
+    compiler.rejectCycles();
+  *error = compiler.error;
+  if(error->isEmpty())
+    rules = compiled;
+}
+
+
+/**
+ * @brief JsonSchema::isNull
+ * @return Returns true if there is no compiled schema.
+ */
+
+bool JsonSchema::isNull() const
+{
+  return rules.isNull();
+}
+
+
+/**
+ * @brief typeBit
+ * @return Returns the JsonSchema::TypeBit of a value; integers have both
+ * IntegerType and NumberType.
+ */
+
+static int typeBit(const QJsonValue &value)
+{
+  switch(value.type()) {
+
+    case QJsonValue::Null:
+      return JsonSchema::NullType;
+
+    case QJsonValue::Bool:
+      return JsonSchema::BooleanType;
+
+    case QJsonValue::Double: {
+      double d = value.toDouble();
+      if(std::isfinite(d) && d == std::floor(d))
+        return JsonSchema::IntegerType | JsonSchema::NumberType;
+      return JsonSchema::NumberType;
+    }
+
+    case QJsonValue::String:
+      return JsonSchema::StringType;
+
+    case QJsonValue::Array:
+      return JsonSchema::ArrayType;
+
+    case QJsonValue::Object:
+      return JsonSchema::ObjectType;
+
+    default:
+      return 0;
+  }
+}
+
+
+/**
+ * @brief canonicalText
+ * @return Returns a text that is equal for equal values, used to find
+ * duplicates for "uniqueItems".
+ */
+
+static QString canonicalText(const QJsonValue &value)
+{
+  if(value.isObject())
+    return QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+  if(value.isArray())
+    return QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+
+  return QString::number(int(value.type())) + ':' + value.toVariant().toString();
+}
+
+
+/**
+ * @brief ownChildRules
+ *
+ * Find the rules a schema itself gives a member or item, without the ones
+ * of its "$ref", "allOf" or "if"; those are checked on their own.
+ *
+ * @param r: Rule of the object or array
+ * @param value: The object or array
+ * @param token: Key of the member, or index of the item
+ * @param children: Receives the rules
+ */
+
+static void ownChildRules(const SchemaRule &r, const QJsonValue &value, const QString &token, QVector<int> *children)
+{
+  if(value.isObject()) {
+      bool matched = false;
+
+      if(r.properties.contains(token)) {
+          children->append(r.properties.value(token));
+          matched = true;
+      }
+      for(const auto &pattern : r.patternProperties) {
+          if(pattern.first.match(token).hasMatch()) {
+              children->append(pattern.second);
+              matched = true;
+          }
+      }
+      if(!matched && r.additionalProperties >= 0)
+        children->append(r.additionalProperties);
+  }
+  else if(value.isArray()) {
+      int i = token.toInt();
+      int itemRule = i < r.prefixItems.count() ? r.prefixItems[i] : r.items;
+      if(itemRule >= 0)
+        children->append(itemRule);
+  }
+}
+
+
+/**
+ * @brief JsonSchema::check
+ *
+ * Validate a value against a rule and record the violations, each under the
+ * pointer of the value whose keyword failed.
+ *
+ * @param rule: Index of the rule
+ * @param value: The value
+ * @param pointer: JSON Pointer of the value in the document
+ * @param deep: If false, the members and items are not checked against their
+ * subschemas; the keywords about the value as a whole still are
+ * @param found: Receives the messages
+ */
+
+void JsonSchema::check(int rule, const QJsonValue &value, const QString &pointer, bool deep, QMap<QString, QStringList> *found) const
+{
+  if(rule < 0)
+    return;
+
+  const SchemaRule &r = rules->at(rule);
+  auto fail = [found, &pointer](const QString &message) { (*found)[pointer].append(message); };
+
+
+  if(r.never) {
+      fail("Not allowed by the schema");
+      return;
+  }
+
+  check(r.ref, value, pointer, deep, found);
+
+  int type = typeBit(value);
+  if(!(r.types & type))
+    fail("Wrong type");
+
+  if(r.hasEnum && !r.enumValues.contains(value))
+    fail("Not one of the allowed values");
+  if(r.hasConst && r.constValue != value)
+    fail("Not the required value");
+
+  if(value.isDouble()) {
+      double d = value.toDouble();
+
+      if(d < r.minimum)
+        fail(QString("Less than the minimum %1").arg(r.minimum));
+      if(d > r.maximum)
+        fail(QString("Greater than the maximum %1").arg(r.maximum));
+      if(d <= r.exclusiveMinimum)
+        fail(QString("Not greater than %1").arg(r.exclusiveMinimum));
+      if(d >= r.exclusiveMaximum)
+        fail(QString("Not less than %1").arg(r.exclusiveMaximum));
+      if(r.multipleOf > 0) {
+          double q = d / r.multipleOf;
+          if(std::fabs(q - std::round(q)) > 1e-9 * qMax(1.0, std::fabs(q)))
+            fail(QString("Not a multiple of %1").arg(r.multipleOf));
+      }
+  }
+  else if(value.isString()) {
+      QString s = value.toString();
+      int length = s.size();
+
+      // Surrogate pairs count as one character.
+      for(QChar c : s)
+        if(c.isLowSurrogate())
+          length--;
+
+      if(length < r.minLength)
+        fail(QString("Shorter than %1 characters").arg(r.minLength));
+      if(r.maxLength >= 0 && length > r.maxLength)
+        fail(QString("Longer than %1 characters").arg(r.maxLength));
+      if(!r.pattern.pattern().isEmpty() && !r.pattern.match(s).hasMatch())
+        fail(QString("Does not match %1").arg(r.pattern.pattern()));
+  }
+  else if(value.isArray()) {
+      QJsonArray jarr = value.toArray();
+
+      if(jarr.count() < r.minItems)
+        fail(QString("Fewer than %1 items").arg(r.minItems));
+      if(r.maxItems >= 0 && jarr.count() > r.maxItems)
+        fail(QString("More than %1 items").arg(r.maxItems));
+
+      if(r.uniqueItems) {
+          QSet<QString> seen;
+          for(const QJsonValue &item : jarr) {
+              QString text = canonicalText(item);
+              if(seen.contains(text)) {
+                  fail("Items are not unique");
+                  break;
+              }
+              seen.insert(text);
+          }
+      }
+
+      if(r.contains >= 0) {
+          bool any = false;
+          for(int i = 0; i < jarr.count() && !any; i++)
+            any = accepts(r.contains, jarr.at(i));
+          if(!any)
+            fail("No item matches \"contains\"");
+      }
+
+      for(int i = 0; deep && i < jarr.count(); i++) {
+          int itemRule = i < r.prefixItems.count() ? r.prefixItems[i] : r.items;
+          check(itemRule, jarr.at(i), JsonPointer::append(pointer, QString::number(i)), deep, found);
+      }
+  }
+  else if(value.isObject()) {
+      QJsonObject jobj = value.toObject();
+
+      if(jobj.count() < r.minProperties)
+        fail(QString("Fewer than %1 members").arg(r.minProperties));
+      if(r.maxProperties >= 0 && jobj.count() > r.maxProperties)
+        fail(QString("More than %1 members").arg(r.maxProperties));
+      for(const QString &key : r.required)
+        if(!jobj.contains(key))
+          fail(QString("Missing member \"%1\"").arg(key));
+
+      for(auto it = jobj.constBegin(); deep && it != jobj.constEnd(); ++it) {
+          QVector<int> memberRules;
+          ownChildRules(r, value, it.key(), &memberRules);
+          for(int memberRule : memberRules)
+            check(memberRule, it.value(), JsonPointer::append(pointer, it.key()), deep, found);
+      }
+  }
+
+  for(int sub : r.allOf)
+    check(sub, value, pointer, deep, found);
+
+  if(!r.anyOf.isEmpty()) {
+      bool any = false;
+      for(int i = 0; i < r.anyOf.count() && !any; i++)
+        any = accepts(r.anyOf[i], value);
+      if(!any)
+        fail("Matches none of \"anyOf\"");
+  }
+
+  if(!r.oneOf.isEmpty()) {
+      int matches = 0;
+      for(int sub : r.oneOf)
+        if(accepts(sub, value))
+          matches++;
+      if(matches != 1)
+        fail(QString("Matches %1 of \"oneOf\" instead of one").arg(matches));
+  }
+
+  if(r.notRule >= 0 && accepts(r.notRule, value))
+    fail("Matches \"not\"");
+
+  if(r.ifRule >= 0)
+    check(accepts(r.ifRule, value) ? r.thenRule : r.elseRule, value, pointer, deep, found);
+}
+
+
+/**
+ * @brief JsonSchema::accepts
+ * @return Returns true if the value and its subtree are valid against the rule.
+ */
+
+bool JsonSchema::accepts(int rule, const QJsonValue &value) const
+{
+  QMap<QString, QStringList> found;
+
+
+  check(rule, value, QString(), true, &found);
+  return found.isEmpty();
+}
+
+
+/**
+ * @brief JsonSchema::childRules
+ *
+ * Find the rules that apply to one member or item of a value: those of
+ * "properties", "patternProperties" and "additionalProperties", or of
+ * "items", including the ones reached through "$ref", "allOf" and the
+ * branch of "if" that applies. The branches of "anyOf", "oneOf" and "not"
+ * are not included; their result is reported at the value itself.
+ *
+ * @param rule: Rule of the value
+ * @param value: The object or array
+ * @param token: Key of the member, or index of the item
+ * @param children: Receives the rules
+ */
+
+void JsonSchema::childRules(int rule, const QJsonValue &value, const QString &token, QVector<int> *children) const
+{
+  if(rule < 0)
+    return;
+
+  const SchemaRule &r = rules->at(rule);
+
+
+  if(r.never)
+    return;
+
+  childRules(r.ref, value, token, children);
+  for(int sub : r.allOf)
+    childRules(sub, value, token, children);
+  if(r.ifRule >= 0)
+    childRules(accepts(r.ifRule, value) ? r.thenRule : r.elseRule, value, token, children);
+
+  ownChildRules(r, value, token, children);
+}
+
+
+/**
+ * @brief JsonSchema::conditional
+ *
+ * Tell whether a rule has an "if", itself or through "$ref", "allOf" or a
+ * branch of "if". An edit below a value with such a rule may change the
+ * branch, and so the rules of the value's other children.
+ *
+ * @param rule: Index of the rule
+ * @param seen: Rules already looked at, since "$ref"s can form cycles
+ * @return Returns true if the rule has an "if".
+ */
+
+bool JsonSchema::conditional(int rule, QSet<int> *seen) const
+{
+  if(rule < 0 || seen->contains(rule))
+    return false;
+
+  const SchemaRule &r = rules->at(rule);
+
+
+  seen->insert(rule);
+  if(r.ifRule >= 0)
+    return true;
+
+  for(int sub : r.allOf)
+    if(conditional(sub, seen))
+      return true;
+
+  return conditional(r.ref, seen);
+}
+
+
+/**
+ * @brief JsonSchema::validate
+ * @param doc: The top-level value of a document
+ * @return Returns the violations of the whole document.
+ */
+
+SchemaViolations JsonSchema::validate(const QJsonValue &doc) const
+{
+  SchemaViolations result;
+
+
+  result.full = true;
+  if(!isNull())
+    check(0, doc, QString(), true, &result.found);
+
+  return result;
+}
+
+
+/**
+ * @brief JsonSchema::revalidate
+ *
+ * Validate what the edits of a document may have changed: the subtree of
+ * each edited value, fully, and its ancestors without their other children.
+ * The rules of each value on the way down are found with childRules(). An
+ * ancestor whose rules have an "if" is checked fully instead, as if it was
+ * the edited value, since its other children may now fall under the other
+ * branch.
+ *
+ * The keywords of an ancestor about the value as a whole still read its
+ * whole subtree: "anyOf", "oneOf", "not" and "contains" validate it against
+ * their subschemas, and "enum", "const" and "uniqueItems" compare whole
+ * values. Without such keywords on the ancestors, the time taken depends on
+ * the depth of the edits and the size of the edited subtrees; with them, for
+ * example an "anyOf" at the root, an edit can cost a full validation.
+ *
+ * @param doc: The top-level value of the document after the edits
+ * @param edited: Paths of the edited values, as keys and indices. After a
+ * member was renamed, or children were inserted, removed or moved, this is
+ * the path of their parent.
+ * @return Returns the violations to merge with SchemaViolations::applyTo().
+ */
+
+SchemaViolations JsonSchema::revalidate(const QJsonValue &doc, const QVector<QStringList> &edited) const
+{
+  SchemaViolations result;
+  QVector<QStringList> paths = edited;
+  QSet<QString> checked;
+
+
+  if(isNull())
+    return result;
+
+  // Stop each path at the first ancestor whose "if" may change with the edit.
+  for(QStringList &path : paths) {
+      QVector<int> applicable{0};
+      QJsonValue value = doc;
+
+      for(int depth = 0; depth < path.count(); depth++) {
+          QSet<int> seen;
+          bool branches = false;
+
+          for(int i = 0; i < applicable.count() && !branches; i++)
+            branches = conditional(applicable[i], &seen);
+          if(branches) {
+              path = path.mid(0, depth);
+              break;
+          }
+
+          QVector<int> next;
+          for(int rule : applicable)
+            childRules(rule, value, path[depth], &next);
+          applicable = next;
+          value = value.isObject() ? value.toObject().value(path[depth]) : value.toArray().at(path[depth].toInt());
+      }
+  }
+
+  // An edit below another edit is covered by it.
+  std::sort(paths.begin(), paths.end(), [](const QStringList &a, const QStringList &b) { return a.count() < b.count(); });
+  for(int i = paths.count() - 1; i >= 0; i--) {
+      for(int j = 0; j < i; j++) {
+          if(paths[j].count() <= paths[i].count() && paths[i].mid(0, paths[j].count()) == paths[j]) {
+              paths.removeAt(i);
+              break;
+          }
+      }
+  }
+
+  for(const QStringList &path : paths) {
+      QVector<int> applicable{0};
+      QJsonValue value = doc;
+      QString pointer;
+
+      for(const QString &token : path) {
+          if(!checked.contains(pointer)) {
+              checked.insert(pointer);
+              result.ancestors.append(pointer);
+              for(int rule : applicable)
+                check(rule, value, pointer, false, &result.found);
+          }
+
+          QVector<int> next;
+          for(int rule : applicable)
+            childRules(rule, value, token, &next);
+          applicable = next;
+
+          value = value.isObject() ? value.toObject().value(token) : value.toArray().at(token.toInt());
+          pointer = JsonPointer::append(pointer, token);
+      }
+
+      result.subtrees.append(pointer);
+      if(!value.isUndefined())
+        for(int rule : applicable)
+          check(rule, value, pointer, true, &result.found);
+  }
+
+  return result;
+}
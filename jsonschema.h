@@ -0,0 +1,160 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QHash>
+#include <QJsonValue>
+#include <QMap>
+#include <QPair>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+
+/**
+ * @brief The SchemaRule struct
+ *
+ * One compiled (sub)schema of a JsonSchema. Subschemas are referred to by
+ * their index in JsonSchema::rules; -1 means absent.
+ */
+struct SchemaRule {
+
+  bool        never;          /**< The schema false: no value is valid */
+  int         types;          /**< Bit mask of JsonSchema::TypeBit; all bits if "type" is absent */
+  bool        hasEnum;        /**< True if "enum" is given */
+  QJsonArray  enumValues;     /**< The values of "enum" */
+  bool        hasConst;       /**< True if "const" is given */
+  QJsonValue  constValue;     /**< The value of "const" */
+  double      minimum;        /**< "minimum"; -infinity if absent */
+  double      maximum;        /**< "maximum"; +infinity if absent */
+  double      exclusiveMinimum; /**< "exclusiveMinimum"; -infinity if absent */
+  double      exclusiveMaximum; /**< "exclusiveMaximum"; +infinity if absent */
+  double      multipleOf;     /**< "multipleOf"; 0 if absent */
+  int         minLength;      /**< "minLength", in code points */
+  int         maxLength;      /**< "maxLength"; -1 if absent */
+  QRegularExpression pattern; /**< "pattern"; empty if absent */
+  int         minItems;       /**< "minItems" */
+  int         maxItems;       /**< "maxItems"; -1 if absent */
+  bool        uniqueItems;    /**< "uniqueItems" */
+  int         items;          /**< Rule of all items, or of the items after prefixItems */
+  QVector<int> prefixItems;   /**< Rules of the first items ("items" as an array, or "prefixItems") */
+  int         contains;       /**< "contains" */
+  int         minProperties;  /**< "minProperties" */
+  int         maxProperties;  /**< "maxProperties"; -1 if absent */
+  QStringList required;       /**< "required" */
+  QHash<QString, int> properties; /**< "properties" */
+  QVector<QPair<QRegularExpression, int>> patternProperties; /**< "patternProperties" */
+  int         additionalProperties; /**< "additionalProperties" */
+  QVector<int> allOf;         /**< "allOf" */
+  QVector<int> anyOf;         /**< "anyOf" */
+  QVector<int> oneOf;         /**< "oneOf" */
+  int         notRule;        /**< "not" */
+  int         ifRule;         /**< "if" */
+  int         thenRule;       /**< "then" */
+  int         elseRule;       /**< "else" */
+  int         ref;            /**< Target of "$ref" */
+
+  SchemaRule();
+};
+
+
+/**
+ * @brief The SchemaViolations struct
+ *
+ * Result of a validation run, by the JSON Pointer of the value each
+ * violation was found at. An incremental run (JsonSchema::revalidate())
+ * only covers part of the document: its messages replace the ones held for
+ * the pointers in @c ancestors, and for the pointers in @c subtrees and all
+ * the pointers below them.
+ */
+struct SchemaViolations {
+
+  QMap<QString, QStringList> found;     /**< Messages, by JSON Pointer */
+  bool                       full;      /**< True if the whole document was validated */
+  QStringList                ancestors; /**< Pointers whose own messages were found again */
+  QStringList                subtrees;  /**< Pointers whose messages, and those below them, were found again */
+  quint64                    version;   /**< Version of the document that was validated */
+
+  SchemaViolations() : full(false), version(0) {}
+  void applyTo(QMap<QString, QStringList> *results) const;
+};
+
+
+/**
+ * @brief The JsonSchema class
+ *
+ * A JSON Schema (the draft 7 keywords, with "prefixItems" of 2020-12)
+ * compiled into a vector of SchemaRule, so that validation does not look
+ * up keywords by name. Only local "$ref"s ("#", "#/definitions/...") are
+ * resolved; "format" and other annotations are ignored.
+ *
+ * Copies share the compiled rules, so a schema can be handed to a worker
+ * thread. A schema is used by one thread at a time: QRegularExpression
+ * optimizes its pattern on first use.
+ *
+ * Each violation is reported at the value whose schema keyword failed, so
+ * the result of a subschema at a value depends only on the subtree of that
+ * value. revalidate() relies on this: after an edit it checks the subtree
+ * of the edited value, and only the keywords of its ancestors that look at
+ * the ancestor itself ("required", "minItems", "anyOf" and so on), not the
+ * other children. An ancestor with an "if" is the exception: the edit may
+ * change the branch that applies to its other children, so it is checked
+ * again as a whole.
+ */
+class JsonSchema
+{
+public:
+  /**
+   * @brief Bits of SchemaRule::types.
+   */
+  enum TypeBit {
+    NullType    = 0x01,
+    BooleanType = 0x02,
+    IntegerType = 0x04,
+    NumberType  = 0x08,   /**< Includes integers */
+    StringType  = 0x10,
+    ArrayType   = 0x20,
+    ObjectType  = 0x40,
+    AnyType     = 0x7f
+  };
+
+  JsonSchema();
+  JsonSchema(const QJsonValue &schema, QString *error);
+
+  bool isNull() const;
+  SchemaViolations validate(const QJsonValue &doc) const;
+  SchemaViolations revalidate(const QJsonValue &doc, const QVector<QStringList> &edited) const;
+
+private:
+  QSharedPointer<QVector<SchemaRule>> rules;  /**< Rule 0 is the root schema */
+
+  void check(int rule, const QJsonValue &value, const QString &pointer, bool deep, QMap<QString, QStringList> *found) const;
+  bool accepts(int rule, const QJsonValue &value) const;
+  void childRules(int rule, const QJsonValue &value, const QString &token, QVector<int> *children) const;
+  bool conditional(int rule, QSet<int> *seen) const;
+};
@@ -0,0 +1,134 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include "jsonsnapshot.h"
+#include "jsonpointer.h"
+
+
+/**
+ * @brief JsonSnapshot::JsonSnapshot
+ *
+ * Create a null snapshot.
+ */
+
+JsonSnapshot::JsonSnapshot() : ver(0), doc(QJsonValue::Undefined)
+{
+}
+
+
+/**
+ * @brief JsonSnapshot::JsonSnapshot
+ * @param version: Version of the document
+ * @param root: Root object or array of the document
+ */
+
+JsonSnapshot::JsonSnapshot(quint64 version, const QJsonValue &root) : ver(version), doc(root)
+{
+}
+
+
+/**
+ * @brief JsonSnapshot::isNull
+ * @return Returns true if the snapshot holds no document.
+ */
+
+bool JsonSnapshot::isNull() const
+{
+  return !doc.isObject() && !doc.isArray();
+}
+
+
+/**
+ * @brief JsonSnapshot::version
+ * @return Returns the version of the model the snapshot was taken at; see
+ * JsonTreeModel::version().
+ */
+
+quint64 JsonSnapshot::version() const
+{
+  return ver;
+}
+
+
+/**
+ * @brief JsonSnapshot::root
+ * @return Returns the root object or array.
+ */
+
+QJsonValue JsonSnapshot::root() const
+{
+  return doc;
+}
+
+
+/**
+ * @brief JsonSnapshot::value
+ *
+ * Look up a value by its path from the root.
+ *
+ * @param path: Keys of object members, and array indices (see JsonPointer::arrayIndex())
+ * @return Returns the value; undefined if the path does not exist.
+ */
+
+QJsonValue JsonSnapshot::value(const QStringList &path) const
+{
+  QJsonValue val = doc;
+
+
+  for(const QString &step : path) {
+      if(val.isObject()) {
+          val = val.toObject().value(step);
+      }
+      else if(val.isArray()) {
+          int i;
+          QJsonArray jarr = val.toArray();
+          if(!JsonPointer::arrayIndex(step, &i) || i >= jarr.size())
+            return QJsonValue(QJsonValue::Undefined);
+          val = jarr.at(i);
+      }
+      else {
+          return QJsonValue(QJsonValue::Undefined);
+      }
+  }
+
+  return val;
+}
+
+
+/**
+ * @brief JsonSnapshot::toJsonDocument
+ * @return Returns the document, e.g. to export it from a worker thread.
+ */
+
+QJsonDocument JsonSnapshot::toJsonDocument() const
+{
+  if(doc.isArray())
+    return QJsonDocument(doc.toArray());
+  if(doc.isObject())
+    return QJsonDocument(doc.toObject());
+  return QJsonDocument();
+}
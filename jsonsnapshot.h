@@ -0,0 +1,63 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QJsonDocument>
+#include <QJsonValue>
+#include <QStringList>
+
+
+/**
+ * @brief The JsonSnapshot class
+ *
+ * A read-only version of the document of a JsonTreeModel, taken with
+ * JsonTreeModel::snapshot(). It can be copied to and read on any thread
+ * while the model keeps being edited.
+ *
+ * The model keeps its document as implicitly shared QJsonValues, and an edit
+ * never changes a value in place: updateNode() builds a new value for each
+ * ancestor of the edited node and leaves the old ones to whoever still
+ * references them. A snapshot is therefore only a reference to the root value
+ * of one version. Taking it costs one reference count; afterwards, each edit
+ * copies just the containers on its path to the root, which is the memory a
+ * snapshot keeps alive.
+ */
+class JsonSnapshot
+{
+public:
+  JsonSnapshot();
+  JsonSnapshot(quint64 version, const QJsonValue &root);
+
+  bool isNull() const;
+  quint64 version() const;
+  QJsonValue root() const;
+  QJsonValue value(const QStringList &path) const;
+  QJsonDocument toJsonDocument() const;
+
+private:
+  quint64     ver;   /**< Version of the model the snapshot was taken at */
+  QJsonValue  doc;   /**< Root object or array of that version */
+};
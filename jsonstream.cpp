@@ -0,0 +1,884 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPair>
+#include <QVector>
+#include "jsonstream.h"
+#include "jsonpointer.h"
+
+
+/**
+ * @brief Size of the blocks read from, and written to, the device.
+ */
+static const int StreamChunk = 64 * 1024;
+
+/**
+ * @brief Longest number token accepted by JsonStreamReader.
+ */
+static const int MaxNumberLength = 256;
+
+/**
+ * @brief Largest magnitude up to which every integer is exactly a double.
+ */
+static const double ExactIntegerLimit = 9007199254740992.0;
+
+
+/**
+ * @brief JsonStreamReader::buildObject
+ *
+ * Create an object from its members. The members are inserted in key order,
+ * which is the order QJsonObject keeps them in, so that every insert appends;
+ * of duplicate keys the last one is kept.
+ */
+
+QJsonObject JsonStreamReader::buildObject(QVector<QPair<QString, QJsonValue>> &members)
+{
+  QJsonObject jobj;
+
+
+  std::stable_sort(members.begin(), members.end(),
+                   [](const QPair<QString, QJsonValue> &a, const QPair<QString, QJsonValue> &b) { return a.first < b.first; });
+  for(const auto &member : members)
+    jobj.insert(member.first, member.second);
+
+  return jobj;
+}
+
+
+/**
+ * @brief JsonStreamReader::JsonStreamReader
+ * @param dev: An open device to read the document from
+ */
+
+JsonStreamReader::JsonStreamReader(QIODevice *dev) : device(dev), source(nullptr), sourceSize(0), cursor(0), consumed(0), shallow(false)
+{
+}
+
+
+/**
+ * @brief JsonStreamReader::JsonStreamReader
+ *
+ * Read a document that is in memory, such as a mapped file. The data is
+ * parsed in place, without copying it.
+ *
+ * @param data: The document text; must stay valid while read() runs
+ * @param size: Its size
+ */
+
+JsonStreamReader::JsonStreamReader(const char *data, qint64 size) : device(nullptr), source(data), sourceSize(size), cursor(0), consumed(0),
+  shallow(false)
+{
+}
+
+
+/**
+ * @brief JsonStreamReader::rawText
+ * @return Returns the original text of the numbers of the document read
+ * whose text differs from the way JsonStreamWriter writes them; null if there
+ * are none.
+ */
+
+QSharedPointer<RawText> JsonStreamReader::rawText() const
+{
+  return raw;
+}
+
+
+/**
+ * @brief JsonStreamReader::offset
+ * @return Returns the byte offset in the input where read() stopped, e.g.
+ * at an error. Unlike QJsonParseError::offset, it is not limited to 2 GiB.
+ */
+
+qint64 JsonStreamReader::offset() const
+{
+  return consumed + cursor;
+}
+
+
+/**
+ * @brief JsonStreamReader::setShallow
+ *
+ * Read only the top level of the document. The non-empty objects and arrays
+ * it holds are not parsed: they are skipped by bracket matching with a
+ * JsonSkipScanner and read as empty placeholders, and skipped() tells where
+ * they are. The text skipped is not checked.
+ *
+ * Only for input in memory; ignored when reading from a device.
+ *
+ * @param on: True to read shallow
+ */
+
+void JsonStreamReader::setShallow(bool on)
+{
+  shallow = on;
+}
+
+
+/**
+ * @brief JsonStreamReader::skipped
+ * @return Returns the byte ranges of the values that a shallow read() left
+ * empty, named like RawText members: by key, or by decimal index.
+ */
+
+QHash<QString, SourceRange> JsonStreamReader::skipped() const
+{
+  return ranges;
+}
+
+
+/**
+ * @brief JsonStreamReader::fill
+ *
+ * Read the next block of input.
+ *
+ * @return Returns false at the end of the input.
+ */
+
+bool JsonStreamReader::fill()
+{
+  consumed += buffer.size();
+  cursor = 0;
+
+  // In memory, the next block is a window on the source.
+  if(source != nullptr) {
+      int n = int(qMin(sourceSize - consumed, qint64(1) << 30));
+      buffer = QByteArray::fromRawData(source + consumed, qMax(n, 0));
+      return n > 0;
+  }
+
+  buffer.resize(StreamChunk);
+
+  qint64 n = device->read(buffer.data(), buffer.size());
+  if(n <= 0) {
+      buffer.clear();
+      return false;
+  }
+
+  buffer.resize(int(n));
+  return true;
+}
+
+
+/**
+ * @brief JsonStreamReader::skipTo
+ *
+ * Continue reading input in memory at the given offset.
+ */
+
+void JsonStreamReader::skipTo(qint64 pos)
+{
+  buffer.clear();
+  consumed = pos;
+  cursor = 0;
+}
+
+
+/**
+ * @brief JsonStreamReader::peek
+ * @return Returns the next byte of input without consuming it; -1 at the end.
+ */
+
+inline int JsonStreamReader::peek()
+{
+  if(cursor >= buffer.size() && !fill())
+    return -1;
+
+  return uchar(buffer.at(cursor));
+}
+
+
+/**
+ * @brief JsonStreamReader::get
+ * @return Returns the next byte of input; -1 at the end.
+ */
+
+inline int JsonStreamReader::get()
+{
+  int c = peek();
+
+
+  if(c >= 0)
+    cursor++;
+  return c;
+}
+
+
+/**
+ * @brief JsonStreamReader::skipSpace
+ *
+ * Skip white space between tokens.
+ */
+
+void JsonStreamReader::skipSpace()
+{
+  for(int c = peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = peek())
+    cursor++;
+}
+
+
+/**
+ * @brief JsonStreamReader::readString
+ *
+ * Read a string; the opening quote has been consumed. Runs of unescaped
+ * characters are copied a block at a time.
+ *
+ * @param str: Receives the string
+ * @param error: Receives the error, if any
+ * @return Returns false on error.
+ */
+
+bool JsonStreamReader::readString(QString *str, QJsonParseError::ParseError *error)
+{
+  QByteArray utf8;
+  QString result;
+
+
+  for(;;) {
+      if(cursor >= buffer.size() && !fill()) {
+          *error = QJsonParseError::UnterminatedString;
+          return false;
+      }
+
+      const char *begin = buffer.constData() + cursor;
+      const char *end = buffer.constData() + buffer.size();
+      const char *p = begin;
+
+      while(p < end && *p != '"' && *p != '\\' && uchar(*p) >= 0x20)
+        p++;
+
+      // A multi-byte character may be split across blocks; it is decoded once complete.
+      utf8.append(begin, int(p - begin));
+      cursor += int(p - begin);
+      if(p == end)
+        continue;
+
+      char c = buffer.at(cursor++);
+      if(c == '"') {
+          result += QString::fromUtf8(utf8);
+          *str = result;
+          return true;
+      }
+
+      if(c != '\\') {
+          *error = QJsonParseError::IllegalValue;
+          return false;
+      }
+
+      result += QString::fromUtf8(utf8);
+      utf8.clear();
+
+      switch(get()) {
+        case '"':  result += QChar('"');  break;
+        case '\\': result += QChar('\\'); break;
+        case '/':  result += QChar('/');  break;
+        case 'b':  result += QChar('\b'); break;
+        case 'f':  result += QChar('\f'); break;
+        case 'n':  result += QChar('\n'); break;
+        case 'r':  result += QChar('\r'); break;
+        case 't':  result += QChar('\t'); break;
+
+        case 'u': {
+          // Surrogate pairs arrive as two escapes and end up as two UTF-16 units.
+          ushort code = 0;
+          for(int i = 0; i < 4; i++) {
+              int h = get();
+              if(h >= '0' && h <= '9')
+                code = ushort(code * 16 + (h - '0'));
+              else if(h >= 'a' && h <= 'f')
+                code = ushort(code * 16 + (h - 'a' + 10));
+              else if(h >= 'A' && h <= 'F')
+                code = ushort(code * 16 + (h - 'A' + 10));
+              else {
+                  *error = QJsonParseError::IllegalEscapeSequence;
+                  return false;
+              }
+          }
+          result += QChar(code);
+          break;
+        }
+
+        default:
+          *error = QJsonParseError::IllegalEscapeSequence;
+          return false;
+      }
+  }
+}
+
+
+/**
+ * @brief JsonStreamReader::readKey
+ *
+ * Read the key of an object member and the following colon.
+ *
+ * @param key: Receives the key
+ * @param error: Receives the error, if any
+ * @return Returns false on error.
+ */
+
+bool JsonStreamReader::readKey(QString *key, QJsonParseError::ParseError *error)
+{
+  skipSpace();
+  int c = get();
+  if(c != '"') {
+      *error = (c < 0) ? QJsonParseError::UnterminatedObject : QJsonParseError::IllegalValue;
+      return false;
+  }
+
+  if(!readString(key, error))
+    return false;
+
+  skipSpace();
+  if(get() != ':') {
+      *error = QJsonParseError::MissingNameSeparator;
+      return false;
+  }
+
+  return true;
+}
+
+
+/**
+ * @brief JsonStreamReader::readNumber
+ *
+ * Read a number. Like QJsonDocument, all numbers are stored as doubles.
+ * The token is collected on the stack, checked against the JSON grammar
+ * and converted with std::from_chars; numbers too large for a double are
+ * an error, as in QJsonDocument. Nothing is allocated unless the text has
+ * to be kept.
+ *
+ * @param val: Receives the number
+ * @param text: Receives the original text if it differs from the way
+ * JsonStreamWriter writes the value; cleared otherwise
+ * @param error: Receives the error, if any
+ * @return Returns false on error.
+ */
+
+bool JsonStreamReader::readNumber(QJsonValue *val, QByteArray *text, QJsonParseError::ParseError *error)
+{
+  char token[MaxNumberLength];
+  int length = 0;
+  double d;
+
+
+  for(int c = peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = peek()) {
+      if(length == MaxNumberLength) {
+          *error = QJsonParseError::IllegalNumber;
+          return false;
+      }
+      token[length++] = char(c);
+      cursor++;
+  }
+
+  std::from_chars_result result = std::from_chars(token, token + length, d);
+  if(!isNumber(token, length) || result.ec != std::errc() || result.ptr != token + length || !std::isfinite(d)) {
+      *error = (peek() < 0) ? QJsonParseError::TerminationByNumber : QJsonParseError::IllegalNumber;
+      return false;
+  }
+
+  if(JsonStreamWriter::isCanonical(token, length, d))
+    text->clear();
+  else
+    *text = QByteArray(token, length);
+
+  *val = QJsonValue(d);
+  return true;
+}
+
+
+/**
+ * @brief JsonStreamReader::isNumber
+ *
+ * @return Returns true if the text is a number as defined by the JSON grammar:
+ * no leading zeros or '+', digits on both sides of the '.', and no "inf" or "nan".
+ */
+
+bool JsonStreamReader::isNumber(const char *text, int length)
+{
+  int i = 0;
+  auto digits = [text, length, &i]() {
+      int start = i;
+      while(i < length && text[i] >= '0' && text[i] <= '9')
+        i++;
+      return i > start;
+  };
+
+
+  if(i < length && text[i] == '-')
+    i++;
+  if(i < length && text[i] == '0')
+    i++;
+  else if(!digits())
+    return false;
+
+  if(i < length && text[i] == '.') {
+      i++;
+      if(!digits())
+        return false;
+  }
+
+  if(i < length && (text[i] == 'e' || text[i] == 'E')) {
+      i++;
+      if(i < length && (text[i] == '+' || text[i] == '-'))
+        i++;
+      if(!digits())
+        return false;
+  }
+
+  return i == length;
+}
+
+
+/**
+ * @brief JsonStreamReader::readLiteral
+ *
+ * Read true, false or null.
+ *
+ * @param word: The expected literal
+ * @param error: Receives the error, if any
+ * @return Returns false if the input does not match word.
+ */
+
+bool JsonStreamReader::readLiteral(const char *word, QJsonParseError::ParseError *error)
+{
+  for(const char *p = word; *p != '\0'; p++) {
+      if(get() != uchar(*p)) {
+          *error = QJsonParseError::IllegalValue;
+          return false;
+      }
+  }
+
+  return true;
+}
+
+
+/**
+ * @brief JsonStreamReader::read
+ *
+ * Parse the document. The top level value must be an object or an array.
+ * Open objects and arrays are kept on an explicit stack; each completed
+ * value is added to the innermost open container, which is closed in turn
+ * when its closing bracket is read. A shallow read (see setShallow()) never
+ * opens more than the top-level container.
+ *
+ * @param err: Receives the result; err->error is QJsonParseError::NoError on success
+ * @return Returns the document; an undefined value on error.
+ */
+
+QJsonValue JsonStreamReader::read(QJsonParseError *err)
+{
+  QVector<ReadFrame> stack;
+  QJsonValue value;
+  QByteArray valueText;
+  QSharedPointer<RawText> valueRaw;
+  QJsonParseError::ParseError error = QJsonParseError::NoError;
+  bool done = false;
+  bool skippedValue = false;
+
+
+  raw.reset();
+  ranges.clear();
+  skipSpace();
+  if(peek() != '{' && peek() != '[')
+    error = QJsonParseError::IllegalValue;
+
+  while(error == QJsonParseError::NoError && !done) {
+
+      // Read one value; an object or array is opened instead.
+      skipSpace();
+      int c = peek();
+      valueText.clear();
+      valueRaw.reset();
+      skippedValue = false;
+
+      if(c == '{' || c == '[') {
+          qint64 at = offset();
+          cursor++;
+          stack.append(ReadFrame{c == '{', {}, QJsonArray(), QString(), QSharedPointer<RawText>()});
+          skipSpace();
+
+          if(c == '{' && peek() == '}') {
+              cursor++;
+              stack.removeLast();
+              value = QJsonObject();
+          }
+          else if(c == '[' && peek() == ']') {
+              cursor++;
+              stack.removeLast();
+              value = QJsonArray();
+          }
+          else if(shallow && source != nullptr && stack.count() == 2) {
+              // A member of the top-level value, which still has to be closed after it.
+              qint64 end = JsonSkipScanner(source, sourceSize).valueEnd(at);
+              stack.removeLast();
+              if(end >= sourceSize)
+                error = stack.last().object ? QJsonParseError::UnterminatedObject : QJsonParseError::UnterminatedArray;
+              ranges.insert(stack.last().name(), SourceRange(at, end));
+              value = (c == '{') ? QJsonValue(QJsonObject()) : QJsonValue(QJsonArray());
+              skippedValue = true;
+              skipTo(end);
+          }
+          else {
+              if(c == '{')
+                readKey(&stack.last().key, &error);
+              continue;
+          }
+      }
+      else if(c == '"') {
+          QString str;
+          cursor++;
+          if(readString(&str, &error))
+            value = QJsonValue(str);
+      }
+      else if(c == 't' && readLiteral("true", &error)) {
+          value = QJsonValue(true);
+      }
+      else if(c == 'f' && readLiteral("false", &error)) {
+          value = QJsonValue(false);
+      }
+      else if(c == 'n' && readLiteral("null", &error)) {
+          value = QJsonValue(QJsonValue::Null);
+      }
+      else if(c == '-' || (c >= '0' && c <= '9')) {
+          readNumber(&value, &valueText, &error);
+      }
+      else if(error == QJsonParseError::NoError) {
+          if(c < 0)
+            error = stack.last().object ? QJsonParseError::UnterminatedObject : QJsonParseError::UnterminatedArray;
+          else
+            error = QJsonParseError::IllegalValue;
+      }
+
+      // Add the value to its container, closing every container it completes.
+      while(error == QJsonParseError::NoError) {
+          if(stack.isEmpty()) {
+              raw = valueRaw;
+              skipSpace();
+              if(peek() >= 0)
+                error = QJsonParseError::GarbageAtEnd;
+              done = true;
+              break;
+          }
+
+          ReadFrame &top = stack.last();
+          if(!valueText.isEmpty() || !valueRaw.isNull()) {
+              if(top.raw.isNull())
+                top.raw = QSharedPointer<RawText>::create();
+              if(!valueText.isEmpty())
+                top.raw->numbers.insert(top.name(), valueText);
+              else
+                top.raw->children.insert(top.name(), valueRaw);
+              valueText.clear();
+          }
+
+          // Of duplicate keys the last one is kept, skipped or not.
+          if(shallow && !skippedValue && top.object && stack.count() == 1)
+            ranges.remove(top.key);
+
+          if(top.object)
+            top.members.append(qMakePair(top.key, value));
+          else
+            top.array.append(value);
+
+          skipSpace();
+          c = get();
+          if(c == ',') {
+              if(top.object)
+                readKey(&top.key, &error);
+              break;
+          }
+
+          if(top.object && c == '}') {
+              value = buildObject(top.members);
+              valueRaw = top.raw;
+              stack.removeLast();
+          }
+          else if(!top.object && c == ']') {
+              value = top.array;
+              valueRaw = top.raw;
+              stack.removeLast();
+          }
+          else if(c < 0) {
+              error = top.object ? QJsonParseError::UnterminatedObject : QJsonParseError::UnterminatedArray;
+          }
+          else {
+              error = QJsonParseError::MissingValueSeparator;
+          }
+      }
+  }
+
+  err->error = error;
+  err->offset = parseErrorOffset(offset());
+  if(error != QJsonParseError::NoError) {
+      raw.reset();
+      ranges.clear();
+      return QJsonValue(QJsonValue::Undefined);
+  }
+
+  return value;
+}
+
+
+/**
+ * @brief JsonStreamWriter::appendString
+ *
+ * Append str as a quoted JSON string, escaped like QJsonDocument does.
+ */
+
+void JsonStreamWriter::appendString(QByteArray &out, const QString &str)
+{
+  QByteArray utf8 = str.toUtf8();
+
+
+  out += '"';
+  for(char c : utf8) {
+      switch(c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b";  break;
+        case '\f': out += "\\f";  break;
+        case '\n': out += "\\n";  break;
+        case '\r': out += "\\r";  break;
+        case '\t': out += "\\t";  break;
+
+        default:
+          if(uchar(c) < 0x20) {
+              static const char hex[] = "0123456789abcdef";
+              out += "\\u00";
+              out += hex[(c >> 4) & 0xf];
+              out += hex[c & 0xf];
+          }
+          else {
+              out += c;
+          }
+          break;
+      }
+  }
+  out += '"';
+}
+
+
+/**
+ * @brief JsonStreamWriter::appendScalar
+ *
+ * Append a value that is not an object or array. Integral numbers are
+ * written without exponent; numbers that are not finite are written as null.
+ */
+
+void JsonStreamWriter::appendScalar(QByteArray &out, const QJsonValue &val)
+{
+  switch(val.type()) {
+
+    case QJsonValue::Type::Bool:
+      out += val.toBool() ? "true" : "false";
+      break;
+
+    case QJsonValue::Type::Double: {
+      char text[NumberTextSize];
+      out.append(text, numberText(val.toDouble(), text));
+      break;
+    }
+
+    case QJsonValue::Type::String:
+      appendString(out, val.toString());
+      break;
+
+    default:
+      out += "null";
+      break;
+  }
+}
+
+
+/**
+ * @brief JsonStreamWriter::numberText
+ *
+ * Integral numbers are written without exponent, others in their shortest
+ * exact form (std::to_chars); numbers that are not finite are written as null.
+ *
+ * @param d: The number
+ * @param buffer: Receives the text; NumberTextSize bytes, not terminated
+ * @return Returns the length of the text written for d.
+ */
+
+int JsonStreamWriter::numberText(double d, char *buffer)
+{
+  std::to_chars_result result;
+
+
+  if(!std::isfinite(d)) {
+      memcpy(buffer, "null", 4);
+      return 4;
+  }
+
+  if(d == std::floor(d) && std::fabs(d) < ExactIntegerLimit)
+    result = std::to_chars(buffer, buffer + NumberTextSize, qint64(d));
+  else
+    result = std::to_chars(buffer, buffer + NumberTextSize, d);
+  return int(result.ptr - buffer);
+}
+
+
+/**
+ * @brief JsonStreamWriter::numberText
+ * @param d: The number
+ * @return Returns the text written for d.
+ */
+
+QByteArray JsonStreamWriter::numberText(double d)
+{
+  char text[NumberTextSize];
+
+
+  return QByteArray(text, numberText(d, text));
+}
+
+
+/**
+ * @brief JsonStreamWriter::isCanonical
+ *
+ * Check whether a number read from a document is written back with the same
+ * text. Plain integer literals that are exact doubles are checked without
+ * formatting the number, since they are by far the most common; others are
+ * formatted on the stack, so nothing is allocated.
+ *
+ * @param text: The number as read
+ * @param length: Its length
+ * @param d: Its value
+ * @return Returns true if numberText(d) equals the text.
+ */
+
+bool JsonStreamWriter::isCanonical(const char *text, int length, double d)
+{
+  int digits = (length > 0 && text[0] == '-') ? 1 : 0;
+  bool integer = length > digits && length - digits <= 15;
+
+
+  for(int i = digits; integer && i < length; i++)
+    integer = text[i] >= '0' && text[i] <= '9';
+
+  if(integer)
+    return (text[digits] != '0' || length - digits == 1) && !(digits == 1 && d == 0);
+
+  char canonical[NumberTextSize];
+  return numberText(d, canonical) == length && memcmp(canonical, text, size_t(length)) == 0;
+}
+
+
+/**
+ * @brief JsonStreamWriter::write
+ *
+ * Write a document, indented like QJsonDocument::toJson(). The text is
+ * written to the device a block at a time; open objects and arrays are kept
+ * on an explicit stack.
+ *
+ * Numbers listed in raw are written with the text they were read with.
+ *
+ * @param dev: An open device
+ * @param doc: The document
+ * @param raw: Original text of numbers, as returned by JsonStreamReader::rawText()
+ * @return Returns false if the device could not be written.
+ */
+
+bool JsonStreamWriter::write(QIODevice *dev, const QJsonDocument &doc, const QSharedPointer<RawText> &raw)
+{
+  QVector<WriteFrame> stack;
+  QByteArray out;
+
+
+  auto open = [&stack, &out](const QJsonValue &val, const QSharedPointer<RawText> &text) {
+      if(val.isObject()) {
+          QJsonObject jobj = val.toObject();
+          stack.append(WriteFrame{jobj, QJsonArray(), true, 0, jobj.size(), text});
+          out += "{\n";
+      }
+      else {
+          QJsonArray jarr = val.toArray();
+          stack.append(WriteFrame{QJsonObject(), jarr, false, 0, jarr.size(), text});
+          out += "[\n";
+      }
+  };
+
+  open(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), raw);
+
+  while(!stack.isEmpty()) {
+      WriteFrame &top = stack.last();
+      int level = stack.count();
+
+      if(top.next == top.count) {
+          out += QByteArray(4 * (level - 1), ' ');
+          out += top.object ? '}' : ']';
+          stack.removeLast();
+          if(stack.isEmpty())
+            out += '\n';
+          else
+            out += (stack.last().next < stack.last().count) ? ",\n" : "\n";
+      }
+      else {
+          QJsonValue val;
+          QString name;
+          int i = top.next++;
+
+          out += QByteArray(4 * level, ' ');
+          if(top.object) {
+              QJsonObject::const_iterator it = top.jobj.constBegin() + i;
+              appendString(out, it.key());
+              out += ": ";
+              val = it.value();
+              name = it.key();
+          }
+          else {
+              val = top.jarr.at(i);
+              if(!top.raw.isNull())
+                name = QString::number(i);
+          }
+
+          if(val.isObject() || val.isArray()) {
+              open(val, top.raw.isNull() ? QSharedPointer<RawText>() : top.raw->children.value(name));
+          }
+          else {
+              if(val.isDouble() && !top.raw.isNull() && top.raw->numbers.contains(name))
+                out += top.raw->numbers.value(name);
+              else
+                appendScalar(out, val);
+              out += (top.next < top.count) ? ",\n" : "\n";
+          }
+      }
+
+      if(out.size() >= StreamChunk) {
+          if(dev->write(out) != out.size())
+            return false;
+          out.clear();
+      }
+  }
+
+  return dev->write(out) == out.size();
+}
@@ -0,0 +1,211 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <limits>
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QSharedPointer>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+
+/**
+ * @brief parseErrorOffset
+ *
+ * QJsonParseError::offset is an int; offsets in files beyond 2 GiB are
+ * clamped to its largest value. The readers report the exact offset with
+ * offset().
+ *
+ * @param offset: A byte offset in the input
+ * @return Returns the offset to store in QJsonParseError::offset.
+ */
+inline int parseErrorOffset(qint64 offset)
+{
+  return int(qMin(offset, qint64(std::numeric_limits<int>::max())));
+}
+
+
+/**
+ * @brief The RawText struct
+ *
+ * Original text of the numbers of an object or array whose text differs
+ * from the way JsonStreamWriter would write their value, such as 1.0, 1e3,
+ * or integers beyond 2^53 that a double cannot hold exactly.
+ *
+ * Members are named by key for objects and by decimal index for arrays.
+ * Only containers that hold such a number somewhere below them have a RawText.
+ */
+struct RawText {
+
+  QHash<QString, QByteArray>               numbers;   /**< Text of the numbers that are direct members */
+  QHash<QString, QSharedPointer<RawText>>  children;  /**< RawText of the member objects and arrays */
+};
+
+
+/**
+ * @brief The SourceRange struct
+ *
+ * Byte range of a value in the text it was read from.
+ */
+struct SourceRange {
+
+  qint64  start;  /**< Offset of the first byte */
+  qint64  end;    /**< Offset after the last byte; not more than start if the range is not known */
+
+  SourceRange() : start(0), end(0) {}
+  SourceRange(qint64 s, qint64 e) : start(s), end(e) {}
+
+  /**
+   * @brief isEmpty
+   * @return Returns true if the range is not known.
+   */
+  bool isEmpty() const { return end <= start; }
+};
+
+
+/**
+ * @brief The ReadFrame struct
+ *
+ * An object or array whose members are being read by JsonStreamReader::read()
+ * or CborStreamReader::read().
+ */
+struct ReadFrame {
+
+  bool                                 object;   /**< True for an object */
+  QVector<QPair<QString, QJsonValue>>  members;  /**< Members of an object, in document order */
+  QJsonArray                           array;    /**< Elements of an array */
+  QString                              key;      /**< Key of the member being read */
+  QSharedPointer<RawText>              raw;      /**< Original text of numbers below this container */
+
+  /**
+   * @brief name
+   * @return Returns the name of the member being read, as used in RawText.
+   */
+  QString name() const { return object ? key : QString::number(array.size()); }
+};
+
+
+/**
+ * @brief The JsonStreamReader class
+ *
+ * JSON parser that reads its input from a QIODevice in blocks, so that a
+ * document can be parsed while it is still being read or decompressed, and
+ * the text of the document is never held in memory as a whole.
+ *
+ * Nesting is handled with an explicit stack and is only limited by memory.
+ * Errors are reported like QJsonDocument::fromJson() does.
+ *
+ * Text in memory can also be read shallow (see setShallow()), to read a
+ * large document one level at a time.
+ */
+class JsonStreamReader
+{
+public:
+  explicit JsonStreamReader(QIODevice *dev);
+  JsonStreamReader(const char *data, qint64 size);
+
+  QJsonValue read(QJsonParseError *err);
+  QSharedPointer<RawText> rawText() const;
+  qint64 offset() const;
+  void setShallow(bool on);
+  QHash<QString, SourceRange> skipped() const;
+
+  static QJsonObject buildObject(QVector<QPair<QString, QJsonValue>> &members);
+  static bool isNumber(const char *text, int length);
+
+private:
+  QIODevice   *device;
+  const char  *source;      /**< Input in memory, when there is no device */
+  qint64       sourceSize;  /**< Size of source */
+  QByteArray   buffer;      /**< The block being parsed */
+  int          cursor;      /**< Position of the next byte in buffer */
+  qint64       consumed;    /**< Bytes of input before buffer */
+  QSharedPointer<RawText> raw;  /**< Number texts of the document read */
+  bool         shallow;     /**< Skip the objects and arrays inside the top-level value */
+  QHash<QString, SourceRange> ranges;  /**< Where the skipped values are */
+
+  bool fill();
+  void skipTo(qint64 pos);
+  int peek();
+  int get();
+  void skipSpace();
+  bool readString(QString *str, QJsonParseError::ParseError *error);
+  bool readKey(QString *key, QJsonParseError::ParseError *error);
+  bool readNumber(QJsonValue *val, QByteArray *text, QJsonParseError::ParseError *error);
+  bool readLiteral(const char *word, QJsonParseError::ParseError *error);
+};
+
+
+/**
+ * @brief The WriteFrame struct
+ *
+ * An object or array whose members are being written by JsonStreamWriter::write()
+ * or CborStreamWriter::write().
+ */
+struct WriteFrame {
+
+  QJsonObject  jobj;    /**< The object, if an object */
+  QJsonArray   jarr;    /**< The array, if an array */
+  bool         object;  /**< True for an object */
+  int          next;    /**< Index of the next member to write */
+  int          count;   /**< Number of members */
+  QSharedPointer<RawText> raw; /**< Original text of numbers below it; may be null */
+};
+
+
+/**
+ * @brief The JsonStreamWriter class
+ *
+ * Writes a document to a QIODevice in blocks, in the format of
+ * QJsonDocument::toJson(QJsonDocument::Indented), without building the
+ * whole text first. Numbers listed in a RawText are written with their
+ * original text.
+ */
+class JsonStreamWriter
+{
+public:
+  static bool write(QIODevice *dev, const QJsonDocument &doc, const QSharedPointer<RawText> &raw = QSharedPointer<RawText>());
+  /**
+   * @brief Size of a buffer that holds any text written by numberText().
+   */
+  static const int NumberTextSize = 32;
+
+  static QByteArray numberText(double d);
+  static int numberText(double d, char *buffer);
+  static bool isCanonical(const char *text, int length, double d);
+
+private:
+  static void appendString(QByteArray &out, const QString &str);
+  static void appendScalar(QByteArray &out, const QJsonValue &val);
+};
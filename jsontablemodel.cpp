@@ -0,0 +1,236 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "jsontablemodel.h"
+
+
+/**
+ * @brief JsonTableModel::JsonTableModel
+ *
+ * @param model: The tree model holding the array
+ * @param arrayIndex: Index of the array in model; an invalid index for the root
+ * @param parent: QObject parent for this object
+ */
+
+JsonTableModel::JsonTableModel(JsonTreeModel *model, const QModelIndex &arrayIndex, QObject *parent) :
+  QAbstractTableModel(parent), tree(model), array(arrayIndex.sibling(arrayIndex.row(), 0))
+{
+  isRoot = !arrayIndex.isValid();
+
+  connect(model, &JsonTreeModel::columnsChanged, this, &JsonTableModel::columnsChanged);
+  connect(model, &QAbstractItemModel::modelReset, this, &JsonTableModel::reset);
+  connect(model, &QAbstractItemModel::rowsRemoved, this, &JsonTableModel::rowsRemoved);
+  connect(model, &QObject::destroyed, this, &JsonTableModel::reset);
+}
+
+
+/**
+ * @brief JsonTableModel::store
+ * @return Returns the ColumnStore of the array; nullptr if the array was
+ * removed or is no longer stored column-wise.
+ */
+
+const ColumnStore *JsonTableModel::store() const
+{
+  if(tree.isNull() || (!isRoot && !array.isValid()))
+    return nullptr;
+
+  return tree->columnStore(array);
+}
+
+
+/**
+ * @brief JsonTableModel::columnsChanged
+ *
+ * Connected to JsonTreeModel::columnsChanged(). Repaints an edited record,
+ * or resets the table when the store of the array was rebuilt.
+ *
+ * @param changed: Index of the array whose store changed
+ * @param row: The edited record; -1 if the store was rebuilt or dropped
+ */
+
+void JsonTableModel::columnsChanged(const QModelIndex &changed, int row)
+{
+  if(changed.internalPointer() != array.internalPointer() || changed.isValid() != array.isValid())
+    return;
+
+  if(row < 0)
+    reset();
+  else
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1), QVector<int>() << Qt::DisplayRole);
+}
+
+
+/**
+ * @brief JsonTableModel::rowsRemoved
+ *
+ * Connected to the rowsRemoved signal of the tree model. Empties the table
+ * when the array was removed, or freed with an evicted subtree.
+ */
+
+void JsonTableModel::rowsRemoved()
+{
+  if(!isRoot && !array.isValid())
+    reset();
+}
+
+
+/**
+ * @brief JsonTableModel::reset
+ *
+ * Show the current state of the store after it was replaced, or after the
+ * tree model was reset or destroyed.
+ */
+
+void JsonTableModel::reset()
+{
+  beginResetModel();
+  endResetModel();
+}
+
+
+/**
+ * @brief JsonTableModel::headerData
+ *
+ * @return Returns the key of a column, or the index of a record.
+ */
+
+QVariant JsonTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  const ColumnStore *columns = store();
+
+
+  if(role != Qt::DisplayRole || columns == nullptr)
+    return QVariant();
+
+  if(orientation == Qt::Vertical)
+    return QVariant(QString("[%1]").arg(section));
+
+  if(section < 0 || section >= columns->columnCount())
+    return QVariant();
+
+  return QVariant(columns->keys()[section]);
+}
+
+
+/**
+ * @brief JsonTableModel::rowCount
+ * @return Returns the number of records.
+ */
+
+int JsonTableModel::rowCount(const QModelIndex &parent) const
+{
+  const ColumnStore *columns = store();
+
+
+  if(parent.isValid() || columns == nullptr)
+    return 0;
+
+  return columns->rowCount();
+}
+
+
+/**
+ * @brief JsonTableModel::columnCount
+ * @return Returns the number of keys.
+ */
+
+int JsonTableModel::columnCount(const QModelIndex &parent) const
+{
+  const ColumnStore *columns = store();
+
+
+  if(parent.isValid() || columns == nullptr)
+    return 0;
+
+  return columns->columnCount();
+}
+
+
+/**
+ * @brief JsonTableModel::data
+ *
+ * @param index: A cell of the table
+ * @param role: DisplayRole or EditRole
+ * @return Returns the value of a key in a record.
+ */
+
+QVariant JsonTableModel::data(const QModelIndex &index, int role) const
+{
+  const ColumnStore *columns = store();
+
+
+  if(!index.isValid() || columns == nullptr)
+    return QVariant();
+
+  if(role != Qt::DisplayRole && role != Qt::EditRole)
+    return QVariant();
+
+  if(index.row() >= columns->rowCount() || index.column() >= columns->columnCount())
+    return QVariant();
+
+  return columns->value(index.row(), index.column()).toVariant();
+}
+
+
+/**
+ * @brief JsonTableModel::setData
+ *
+ * Forward an edit to JsonTreeModel::setCell(). The table is repainted by
+ * columnsChanged().
+ *
+ * @return Returns true if the value was changed.
+ */
+
+bool JsonTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+  Q_UNUSED(role)
+
+  if(!index.isValid() || store() == nullptr)
+    return false;
+
+  return tree->setCell(array, index.row(), index.column(), value);
+}
+
+
+/**
+ * @brief JsonTableModel::flags
+ *
+ * Cells of string, number and boolean columns are editable; null columns are not.
+ */
+
+Qt::ItemFlags JsonTableModel::flags(const QModelIndex &index) const
+{
+  const ColumnStore *columns = store();
+
+
+  if(!index.isValid() || columns == nullptr)
+    return Qt::NoItemFlags;
+
+  if(columns->type(index.column()) == QJsonValue::Null)
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+
+  return Qt::ItemIsEditable | Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
@@ -0,0 +1,71 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QPersistentModelIndex>
+#include <QPointer>
+#include "jsontreemodel.h"
+
+
+/**
+ * @brief The JsonTableModel class
+ *
+ * Flat table over an array of a JsonTreeModel that is stored column-wise
+ * (see ColumnStore): one row per record and one column per key.
+ * Values are read from the typed columns, without TreeNodes or QJsonObject
+ * lookups; edits go through JsonTreeModel::setCell(), so the tree and the
+ * table always show the same document.
+ */
+class JsonTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+private:
+  QPointer<JsonTreeModel>  tree;
+  QPersistentModelIndex    array;
+  bool                     isRoot;
+
+  const ColumnStore *store() const;
+
+private slots:
+  void columnsChanged(const QModelIndex &changed, int row);
+  void rowsRemoved();
+  void reset();
+
+public:
+  JsonTableModel(JsonTreeModel *model, const QModelIndex &arrayIndex, QObject *parent = nullptr);
+
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+  bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+
+  Qt::ItemFlags flags(const QModelIndex& index) const override;
+};
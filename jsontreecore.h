@@ -0,0 +1,710 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <QByteArray>
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/**
+ * @brief The SubtreeStats struct
+ *
+ * Size of the subtree of a node, as computed by JsonTreeCore::nodeStats().
+ * JsonTreeModel shows it in its statistics columns.
+ */
+struct SubtreeStats {
+
+  qint64   nodes;   /**< Number of values in the subtree, including the node itself */
+  int      depth;   /**< Number of levels in the subtree; 1 for a scalar */
+  qint64   bytes;   /**< Approximate size of the subtree as compact JSON, including the
+                      "key": prefix of object members */
+
+  SubtreeStats() : nodes(0), depth(0), bytes(0) {}
+};
+
+
+/**
+ * @brief The QtJsonTraits struct
+ *
+ * Default policy of JsonTreeCore, used by JsonTreeModel: QString keys,
+ * QJsonValue values, children in a QList, and containers below the root
+ * built when they are first visited.
+ *
+ * A policy gives the types Key and Value, the template Storage of the
+ * children list (with push_back(), insert(), size() and operator[]), the
+ * constant Lazy, and the static functions:
+ * @li key(k) and text(key): a key as given by forEachChild() to a Key, and back
+ * @li isContainer(v) and isObject(v)
+ * @li forEachChild(v, f): f(k, child) for each member or item of v, in document order
+ * @li scalarBytes(v): length of a scalar written as compact JSON
+ *
+ * The core only goes through these, so another value type only needs
+ * another policy; see CborValueTraits. Derive from a policy to change some
+ * of them.
+ *
+ * The header only depends on QtCore, so that tools without a GUI can use
+ * the core without linking the rest of qjtree.
+ */
+struct QtJsonTraits {
+
+  typedef QString     Key;    /**< Type of object keys */
+  typedef QJsonValue  Value;  /**< Type of values */
+  template<typename T> using Storage = QList<T>;  /**< Container of the children of a node */
+
+  /**
+   * @brief If true, the children of a container are built on demand, one
+   * level at a time; if false, a whole subtree is built at once.
+   */
+  static constexpr bool Lazy = true;
+
+  static Key key(const QString &text) { return text; }
+  static QString text(const Key &key) { return key; }
+  static bool isContainer(const Value &value) { return value.isObject() || value.isArray(); }
+  static bool isObject(const Value &value) { return value.isObject(); }
+
+  /**
+   * @brief Call f(key, value) for each member of an object, or f("", item)
+   * for each item of an array, in document order.
+   */
+  template<typename F>
+  static void forEachChild(const Value &value, F &&f) {
+
+    if(value.isObject()) {
+        QJsonObject jobj = value.toObject();
+        for(auto it = jobj.constBegin(); it != jobj.constEnd(); ++it)
+          f(it.key(), it.value());
+    }
+    else if(value.isArray()) {
+        QJsonArray jarr = value.toArray();
+        for(int i = 0; i < jarr.size(); i++)
+          f(QString(""), jarr.at(i));
+    }
+  }
+
+  /**
+   * @brief Length of a number written as compact JSON, as
+   * JsonStreamWriter::numberText() writes it: integers without exponent,
+   * others in their shortest exact form, and null if not finite.
+   */
+  static qint64 numberBytes(double d) {
+
+    char text[32];
+    std::to_chars_result result;
+
+    if(!std::isfinite(d))
+      return 4;
+
+    if(d == std::floor(d) && std::fabs(d) < 9007199254740992.0)
+      result = std::to_chars(text, text + sizeof(text), qint64(d));
+    else
+      result = std::to_chars(text, text + sizeof(text), d);
+    return result.ptr - text;
+  }
+
+  /**
+   * @brief Length of a scalar written as compact JSON. Escapes in strings
+   * are not counted.
+   */
+  static qint64 scalarBytes(const Value &value) {
+
+    switch(value.type()) {
+
+      case QJsonValue::Bool:
+        return value.toBool() ? 4 : 5;
+
+      case QJsonValue::Double:
+        return numberBytes(value.toDouble());
+
+      case QJsonValue::String:
+        return value.toString().length() + 2;
+
+      default:
+        return 4;
+    }
+  }
+};
+
+
+/**
+ * @brief The Utf8KeyTraits struct
+ *
+ * Keys as UTF-8 QByteArrays, about half the size of QString keys for the
+ * usual ASCII keys, for tools that hold large trees and do not display them.
+ */
+struct Utf8KeyTraits : QtJsonTraits {
+
+  typedef QByteArray Key;
+
+  static Key key(const QString &text) { return text.toUtf8(); }
+  static QString text(const Key &key) { return QString::fromUtf8(key); }
+};
+
+
+/**
+ * @brief The EagerVectorTraits struct
+ *
+ * Children in a std::vector, and whole subtrees built at once, for tools
+ * that visit every node anyway.
+ */
+struct EagerVectorTraits : QtJsonTraits {
+
+  template<typename T> using Storage = std::vector<T>;
+
+  static constexpr bool Lazy = false;
+};
+
+
+/**
+ * @brief The CborValueTraits struct
+ *
+ * QCborValue values, as read by QCborValue::fromCbor(), for tools that
+ * work on CBOR without converting it to QJsonValue. Map keys are shown as
+ * strings, as CborStreamReader does.
+ */
+struct CborValueTraits : QtJsonTraits {
+
+  typedef QCborValue Value;
+
+  static bool isContainer(const Value &value) { return value.isMap() || value.isArray(); }
+  static bool isObject(const Value &value) { return value.isMap(); }
+
+  template<typename F>
+  static void forEachChild(const Value &value, F &&f) {
+
+    if(value.isMap()) {
+        QCborMap map = value.toMap();
+        for(auto it = map.constBegin(); it != map.constEnd(); ++it)
+          f(it.key().toVariant().toString(), it.value());
+    }
+    else if(value.isArray()) {
+        QCborArray array = value.toArray();
+        for(qsizetype i = 0; i < array.size(); i++)
+          f(QString(""), array.at(i));
+    }
+  }
+
+  static qint64 scalarBytes(const Value &value) {
+
+    if(value.isBool())
+      return value.toBool() ? 4 : 5;
+    if(value.isInteger())
+      return numberBytes(double(value.toInteger()));
+    if(value.isDouble())
+      return numberBytes(value.toDouble());
+    if(value.isString())
+      return value.toString().length() + 2;
+    return 4;
+  }
+};
+
+
+/**
+ * @brief The BasicTreeNode struct
+ *
+ * A node of a JsonTreeCore: a value, with its key and its children.
+ * A node type with more members derives from it, naming itself as Derived
+ * (as TreeNode does), so that parent and children point to the derived type.
+ *
+ * Nodes are deleted through the Derived type; there is no virtual destructor.
+ */
+template<typename Traits, typename Derived = void>
+struct BasicTreeNode {
+
+  typedef typename std::conditional<std::is_void<Derived>::value, BasicTreeNode, Derived>::type Node;
+  typedef typename Traits::Key   Key;
+  typedef typename Traits::Value Value;
+
+  Node              *parent;    /**< Address of the parent node (nullptr for root) */
+  typename Traits::template Storage<Node *> children; /**< List of child elements under this node */
+  Key                key;       /**< The key by which this node is known (displayed in column 0).
+                                  This string is empty ("") for array elements. */
+  Value              data;      /**< The value of the node. This is displayed in the tree view. */
+  bool               populated; /**< False for a container whose children have not been built yet.
+                                  Its children are created from @c data on the first fetchMore(). */
+  int                pos;       /**< Position of this node in the @c children of its parent (document
+                                  order). Kept up to date when children are inserted, removed or moved. */
+
+
+  BasicTreeNode(Node *p, const Key &k, const Value &d) : parent(p), key(k), data(d), populated(true), pos(0) {}
+
+  /**
+   * @brief renumber
+   *
+   * Update the row of the children from the given row on, after children
+   * were inserted, removed or moved.
+   *
+   * @param from: First row whose position may have changed
+   */
+  void renumber(int from) {
+
+    for(int i = from; i < int(children.size()); i++)
+      children[i]->pos = i;
+  }
+};
+
+
+/**
+ * @brief The JsonTreeCore class
+ *
+ * The tree of a JSON document, without QAbstractItemModel: it owns the
+ * nodes, builds them from the values, and visits, finds, measures and frees
+ * them. Nodes are reached through plain pointers and visited with a functor,
+ * which the compiler inlines, so a traversal neither boxes values in
+ * QVariants nor calls virtual functions. The policy (see QtJsonTraits)
+ * chooses the key and value types, the storage of the children and whether
+ * containers are built lazily; the choices are made at compile time.
+ *
+ * JsonTreeModel holds its tree of TreeNodes in a JsonTreeCore and adds
+ * only what a view needs: indexes, display order and edits. The static
+ * functions work on any subtree.
+ */
+template<typename Traits, typename NodeT = BasicTreeNode<Traits>>
+class JsonTreeCore
+{
+public:
+  typedef NodeT                  Node;
+  typedef typename Traits::Key   Key;
+  typedef typename Traits::Value Value;
+
+  /**
+   * @brief Create an empty tree; see reset().
+   */
+  JsonTreeCore() : top(nullptr) {}
+
+  /**
+   * @brief Build the tree of a document: the root and its children, or
+   * all of it if the policy is not Lazy.
+   * @param doc: The top-level value
+   */
+  explicit JsonTreeCore(const Value &doc) : top(new Node(nullptr, Key(), doc)) {
+
+    build(top);
+  }
+
+  ~JsonTreeCore() { reset(); }
+
+  JsonTreeCore(const JsonTreeCore &) = delete;
+  JsonTreeCore &operator=(const JsonTreeCore &) = delete;
+
+  Node *root() const { return top; }
+
+  /**
+   * @brief reset
+   *
+   * Free the tree, and take node as the new root.
+   *
+   * @param node: The new root; nullptr to leave the tree empty
+   * @return Returns the number of nodes freed.
+   */
+  qint64 reset(Node *node = nullptr) {
+
+    qint64 count = top != nullptr ? free(top) : 0;
+
+    top = node;
+    return count;
+  }
+
+  /**
+   * @brief release
+   *
+   * Give up the tree without freeing it, e.g. to free it on another thread
+   * with free(), and leave this one empty.
+   *
+   * @return Returns the root; the caller owns the nodes.
+   */
+  Node *release() {
+
+    Node *node = top;
+
+    top = nullptr;
+    return node;
+  }
+
+  /**
+   * @brief addChild
+   *
+   * Allocate a node and append it to the children of parent.
+   *
+   * @return Returns the new node.
+   */
+  static Node *addChild(Node *parent, const Key &key, const Value &value) {
+
+    Node *node = new Node(parent, key, value);
+
+    node->pos = int(parent->children.size());
+    parent->children.push_back(node);
+    return node;
+  }
+
+  /**
+   * @brief insertChild
+   *
+   * Allocate a node and insert it into the children of parent before the
+   * given row; the rows after it are renumbered.
+   *
+   * @return Returns the new node.
+   */
+  static Node *insertChild(Node *parent, int row, const Key &key, const Value &value) {
+
+    Node *node = new Node(parent, key, value);
+
+    parent->children.insert(parent->children.begin() + row, node);
+    parent->renumber(row);
+    return node;
+  }
+
+  /**
+   * @brief populate
+   *
+   * Create the children of a node that is not populated yet. Only one level
+   * is built; child containers are left unpopulated in turn.
+   *
+   * @param node: The node
+   * @param make: Called as make(parent, key, value) to create each child,
+   * e.g. addChild(); returns the new node
+   */
+  template<typename F>
+  static void populate(Node *node, F &&make) {
+
+    node->populated = true;
+    Traits::forEachChild(node->data, [node, &make](const auto &key, const auto &value) {
+        Node *child = make(node, Traits::key(key), value);
+        if(Traits::isContainer(child->data))
+          child->populated = false;
+    });
+  }
+
+  static void populate(Node *node) { populate(node, &JsonTreeCore::addChild); }
+
+  /**
+   * @brief build
+   *
+   * Build the whole subtree of node, depth first, with an explicit stack, so
+   * the depth of the document is only limited by memory.
+   *
+   * @param node: An unbuilt container
+   * @param make: Called as make(parent, key, value) to create each node;
+   * returns it
+   * @param descend: Called with each child container, in document order
+   * (depth first); returns false to leave it unbuilt
+   * @param built: Called with each container once its children are created
+   */
+  template<typename Make, typename Descend, typename Built>
+  static void build(Node *node, Make &&make, Descend &&descend, Built &&built) {
+
+    std::vector<Node *> stack;
+
+    stack.push_back(node);
+    while(!stack.empty()) {
+        Node *n = stack.back();
+        stack.pop_back();
+        if(n != node && !descend(n))
+          continue;
+
+        populate(n, make);
+        built(n);
+        for(int i = int(n->children.size()) - 1; i >= 0; i--)
+          if(!n->children[i]->populated)
+            stack.push_back(n->children[i]);
+    }
+  }
+
+  /**
+   * @brief build
+   *
+   * Build the children of a node: one level with a Lazy policy, the whole
+   * subtree otherwise.
+   */
+  static void build(Node *node) {
+
+    if(!Traits::isContainer(node->data))
+      return;
+
+    if constexpr(Traits::Lazy)
+      populate(node);
+    else
+      build(node, &JsonTreeCore::addChild, [](Node *) { return true; }, [](Node *) {});
+  }
+
+  /**
+   * @brief visit
+   *
+   * Call f(node, depth) for node and every node below it that is built, in
+   * document order, depth first. If f returns a bool, false skips the
+   * children of that node.
+   */
+  template<typename F>
+  static void visit(Node *node, F &&f) {
+
+    std::vector<std::pair<Node *, int>> stack;
+
+    stack.push_back(std::make_pair(node, 0));
+    while(!stack.empty()) {
+        std::pair<Node *, int> next = stack.back();
+        stack.pop_back();
+
+        if constexpr(std::is_same<decltype(f(next.first, next.second)), bool>::value) {
+            if(!f(next.first, next.second))
+              continue;
+        }
+        else {
+            f(next.first, next.second);
+        }
+
+        for(int i = int(next.first->children.size()) - 1; i >= 0; i--)
+          stack.push_back(std::make_pair(next.first->children[i], next.second + 1));
+    }
+  }
+
+  /**
+   * @brief visitAll
+   *
+   * Call f(node, depth) for every node of the tree, as visit() does, building
+   * the containers that are not built yet on the way.
+   */
+  template<typename F>
+  void visitAll(F &&f) {
+
+    visit(top, [&f](Node *node, int depth) {
+        if(!node->populated)
+          populate(node);
+        return f(node, depth);
+    });
+  }
+
+  /**
+   * @brief levels
+   *
+   * @return Returns the built nodes of a subtree by depth: node first, then
+   * its children, and so on; to compute something bottom-up one level at a time.
+   */
+  static QVector<QVector<Node *>> levels(Node *node) {
+
+    QVector<QVector<Node *>> result;
+
+    result.append(QVector<Node *>() << node);
+    for(;;) {
+        QVector<Node *> next;
+        for(auto n : result.last())
+          for(int i = 0; i < int(n->children.size()); i++)
+            next.append(n->children[i]);
+
+        if(next.isEmpty())
+          break;
+        result.append(next);
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief find
+   *
+   * Look a node up by its path.
+   *
+   * @param node: Node the path starts from
+   * @param path: Keys of object members, and array indices (see arrayIndex())
+   * @param build: If true, containers on the way are built; if false, the
+   * path must be built already
+   * @return Returns the node; nullptr if the path does not exist.
+   */
+  static Node *find(Node *node, const QStringList &path, bool build) {
+
+    for(const QString &step : path) {
+        Node *next = nullptr;
+        int index;
+
+        if(node == nullptr)
+          return nullptr;
+
+        if(!node->populated) {
+            if(!build)
+              return nullptr;
+            populate(node);
+        }
+
+        if(Traits::isObject(node->data)) {
+            Key key = Traits::key(step);
+            for(int i = 0; i < int(node->children.size()) && next == nullptr; i++)
+              if(node->children[i]->key == key)
+                next = node->children[i];
+        }
+        else if(arrayIndex(step, &index) && index < int(node->children.size())) {
+            next = node->children[index];
+        }
+
+        node = next;
+    }
+
+    return node;
+  }
+
+  Node *find(const QStringList &path) const { return find(top, path, true); }
+
+  /**
+   * @brief arrayIndex
+   *
+   * Read a path step as an array index, as JsonPointer::arrayIndex() does:
+   * decimal digits only, without a sign or leading zeros.
+   *
+   * @return Returns false if the step is not an array index.
+   */
+  static bool arrayIndex(const QString &step, int *index) {
+
+    bool ok;
+
+    if(step.isEmpty() || (step.size() > 1 && step[0].unicode() == '0'))
+      return false;
+
+    for(int i = 0; i < step.size(); i++)
+      if(step[i].unicode() < '0' || step[i].unicode() > '9')
+        return false;
+
+    *index = step.toInt(&ok);
+    return ok;
+  }
+
+  /**
+   * @brief valueStats
+   *
+   * Compute the statistics of a value that has no nodes, such as an
+   * unpopulated container. The traversal uses an explicit stack.
+   *
+   * @return Returns the statistics of value, without a key prefix.
+   */
+  static SubtreeStats valueStats(const Value &value) {
+
+    std::vector<std::pair<Value, int>> stack;
+    SubtreeStats result;
+
+    stack.push_back(std::make_pair(value, 1));
+    while(!stack.empty()) {
+        std::pair<Value, int> next = stack.back();
+        qint64 members = 0;
+        stack.pop_back();
+
+        result.nodes++;
+        result.depth = qMax(result.depth, next.second);
+        if(!Traits::isContainer(next.first)) {
+            result.bytes += Traits::scalarBytes(next.first);
+            continue;
+        }
+
+        bool object = Traits::isObject(next.first);
+        Traits::forEachChild(next.first, [&](const auto &key, const auto &child) {
+            if(object)
+              result.bytes += Traits::key(key).size() + 3;
+            stack.push_back(std::make_pair(Value(child), next.second + 1));
+            members++;
+        });
+        result.bytes += 2 + qMax(members - 1, qint64(0));
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief nodeStats
+   *
+   * Compute the statistics of a node from those of its children, which
+   * must be up to date. Scalars and unpopulated containers are computed
+   * from their value.
+   *
+   * @param node: The node
+   * @param stats: Called as stats(child); returns the statistics of a child
+   * @return Returns the statistics of node, with the "key": prefix of an
+   * object member.
+   */
+  template<typename F>
+  static SubtreeStats nodeStats(Node *node, F &&stats) {
+
+    SubtreeStats result;
+
+    if(node->populated && Traits::isContainer(node->data)) {
+        result.nodes = 1;
+        result.depth = 1;
+        result.bytes = 2 + qMax(int(node->children.size()) - 1, 0);
+        for(int i = 0; i < int(node->children.size()); i++) {
+            const SubtreeStats &child = stats(node->children[i]);
+            result.nodes += child.nodes;
+            result.depth = qMax(result.depth, child.depth + 1);
+            result.bytes += child.bytes;
+        }
+    }
+    else {
+        result = valueStats(node->data);
+    }
+
+    if(node->parent != nullptr && Traits::isObject(node->parent->data))
+      result.bytes += node->key.size() + 3;
+
+    return result;
+  }
+
+  /**
+   * @brief free
+   *
+   * Delete node and its subtree, with an explicit stack. Static, so that a
+   * released tree can be freed on a worker thread.
+   *
+   * @return Returns the number of deleted nodes.
+   */
+  static qint64 free(Node *node) {
+
+    std::vector<Node *> stack;
+    qint64 count = 0;
+
+    stack.push_back(node);
+    while(!stack.empty()) {
+        Node *n = stack.back();
+        stack.pop_back();
+        for(int i = 0; i < int(n->children.size()); i++)
+          stack.push_back(n->children[i]);
+
+        delete n;
+        count++;
+    }
+
+    return count;
+  }
+
+private:
+  Node *top;  /**< The root node; nullptr for an empty tree */
+};
@@ -24,23 +24,52 @@ SOFTWARE.
 
 #include <string>
 #include <iostream>
-#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <QFile>
+#include <QFileInfo>
 #include <QByteArray>
+#include <QMap>
+#include <QPair>
+#include <QThread>
+#include <QSet>
+#include <QtConcurrent>
+#include <QColor>
 #include "jsontreemodel.h"
+#include "compresseddevice.h"
+#include "jsonstream.h"
+#include "jsonpointer.h"
 
 
 /**
  * @brief JsonTreeModel::JsonTreeModel
  * @param parent: QObject parent for this object
  *
- * Initialize the root document to nullptr.
+ * The tree starts empty.
  *
  */
 
 JsonTreeModel::JsonTreeModel(QObject *parent) : QAbstractItemModel(parent)
 {
-  root = nullptr;
+  modified = false;
+  options = NoLoadOptions;
+  format = JsonFormat;
+  errorAt = 0;
+  documentVersion = 0;
+  stats = MemoryStats{0, 0, 0, 0, 0, 0, 0, 0, 0};
+  budget = 0;
+  rangeSize = 0;
+  useClock = 0;
+  sortColumn = -1;
+  sortOrder = Qt::AscendingOrder;
+  transactionOpen = false;
+  modifiedBeforeTransaction = false;
+  fullValidation = false;
+  validating = false;
+  validation = new QFutureWatcher<SchemaViolations>(this);
+  journal = new EditJournal(this);
+  connect(validation, &QFutureWatcher<SchemaViolations>::finished, this, &JsonTreeModel::validationFinished);
 }
 
 
@@ -57,536 +86,4187 @@ JsonTreeModel::JsonTreeModel(QObject *parent) : QAbstractItemModel(parent)
  *
  */
 
-JsonTreeModel::JsonTreeModel(const QString &file, QJsonParseError *err, QObject *parent) : JsonTreeModel(parent)
+JsonTreeModel::JsonTreeModel(const QString &file, QJsonParseError *err, QObject *parent) : JsonTreeModel(file, err, NoLoadOptions, parent)
+{
+}
+
+
+/**
+ * @brief JsonTreeModel::JsonTreeModel
+ * @param file: Name of the JSON file to open
+ * @param err: Address of a QJsonParseError object
+ * @param opts: Load options, e.g. Deduplicate
+ * @param parent: QObject parent for this object
+ *
+ * As JsonTreeModel(const QString &, QJsonParseError *, QObject *), with the
+ * given load options applied while the TreeNode structure is built.
+ *
+ * Plain files are mapped into memory and parsed in place by JsonStreamReader,
+ * without reading them into a buffer first. gzip and zstd files are recognized
+ * by their content. They are parsed while a CompressedDevice decompresses them
+ * on a worker thread, so the decompressed text is never held in memory as a whole.
+ *
+ * CBOR files, compressed or not, are recognized by their first bytes (see
+ * CborStreamReader::detect()) and read with CborStreamReader; fileFormat()
+ * then returns CborFormat.
+ *
+ * Numbers whose text would not be written back unchanged (e.g. 1.50, 1e3, or
+ * integers beyond the precision of a double) keep their text; see TreeNode::raw.
+ *
+ * With the OnDemand option, a plain JSON file is read one level at a time:
+ * only the top-level value is parsed now, and the objects and arrays in it
+ * are left in the file until they are expanded; see refault(). The text
+ * that is not parsed yet is not checked for errors. The option is ignored
+ * with the other load options, and for compressed and CBOR files.
+ *
+ */
+
+JsonTreeModel::JsonTreeModel(const QString &file, QJsonParseError *err, LoadOptions opts, QObject *parent) : JsonTreeModel(parent)
+{
+  QSharedPointer<RawText> rootText;
+  QHash<QString, SourceRange> ranges;
+  bool onDemand = (opts & OnDemand) && !(opts & (Deduplicate | SubtreeStatistics | Columnar));
+
+
+
+  options = opts;
+  sourceFile = file;
+  QJsonValue rootValue = readFile(file, err, &rootText, onDemand ? &ranges : nullptr);
+
+  if(err->error == QJsonParseError::NoError)
+    rebuild(rootValue, rootText, ranges);
+
+}
+
+
+/**
+ * @brief JsonTreeModel::readFile
+ *
+ * Parse a whole file, as described for the loading constructor, and set the
+ * format from its content.
+ *
+ * @param file: Name of the file
+ * @param err: Receives the parse error, if any
+ * @param text: Receives the texts of the numbers that need them
+ * @param ranges: If not null, a plain JSON file is read shallow (see
+ * JsonStreamReader::setShallow()), and ranges receives where the members
+ * left in the file are; the file is then the one refault() reads from.
+ * @return Returns the top-level value.
+ */
+
+QJsonValue JsonTreeModel::readFile(const QString &file, QJsonParseError *err, QSharedPointer<RawText> *text,
+                                   QHash<QString, SourceRange> *ranges)
+{
+  QFile jsonFile(file);
+  QJsonValue rootValue;
+
+
+  format = JsonFormat;
+  jsonFile.open(QIODevice::ReadOnly);
+  CompressedDevice::Format compression = CompressedDevice::detect(&jsonFile);
+
+  if(compression == CompressedDevice::Plain && CborStreamReader::detect(&jsonFile)) {
+      CborStreamReader reader(&jsonFile);
+      format = CborFormat;
+      rootValue = reader.read(err);
+      *text = reader.rawText();
+      errorAt = reader.offset();
+  }
+  else if(compression == CompressedDevice::Plain) {
+      uchar *mapped = jsonFile.size() > 0 ? jsonFile.map(0, jsonFile.size()) : nullptr;
+
+      if(mapped != nullptr) {
+          JsonStreamReader reader(reinterpret_cast<const char *>(mapped), jsonFile.size());
+          reader.setShallow(ranges != nullptr);
+          rootValue = reader.read(err);
+          *text = reader.rawText();
+          errorAt = reader.offset();
+          jsonFile.unmap(mapped);
+
+          if(ranges != nullptr && err->error == QJsonParseError::NoError) {
+              *ranges = reader.skipped();
+              rangeFile = file;
+              rangeSize = jsonFile.size();
+              rangeTime = QFileInfo(jsonFile).lastModified();
+          }
+      }
+      else {
+          JsonStreamReader reader(&jsonFile);
+          rootValue = reader.read(err);
+          *text = reader.rawText();
+          errorAt = reader.offset();
+      }
+  }
+  else {
+      // Decompressed on a worker thread while this one parses.
+      CompressedDevice inflater(&jsonFile, compression);
+      if(inflater.open(QIODevice::ReadOnly) && CborStreamReader::detect(&inflater)) {
+          CborStreamReader reader(&inflater);
+          format = CborFormat;
+          rootValue = reader.read(err);
+          *text = reader.rawText();
+          errorAt = reader.offset();
+          inflater.close();
+      }
+      else if(inflater.isOpen()) {
+          JsonStreamReader reader(&inflater);
+          rootValue = reader.read(err);
+          *text = reader.rawText();
+          errorAt = reader.offset();
+          inflater.close();
+      }
+      else {
+          err->error = QJsonParseError::IllegalValue;
+          err->offset = 0;
+          errorAt = 0;
+      }
+  }
+  jsonFile.close();
+  stats.documentBytes = errorAt;
+
+  return rootValue;
+}
+
+
+/**
+ * @brief JsonTreeModel::JsonTreeModel
+ * @param file: Name of the JSON file to open
+ * @param pointer: JSON Pointer (RFC 6901) of the value to open, e.g. "/store/books/3"
+ * @param err: Address of a QJsonParseError object
+ * @param opts: Load options, e.g. Deduplicate
+ * @param parent: QObject parent for this object
+ *
+ * Open only the value the pointer refers to. The mapped file is scanned by a
+ * JsonSkipScanner, which skips the members and items that are not on the path
+ * without parsing them; then only the target value is parsed. Its ancestors
+ * hold nothing but the path to it, so the time taken depends on the bytes
+ * scanned before the target and on the size of the target, not on the size
+ * of the document.
+ *
+ * The model is then partial (see isPartial()): the ancestors cannot be
+ * edited, and the rest of the document is read by loadRest(). Compressed and
+ * CBOR files, and the empty pointer, are loaded whole.
+ *
+ * err->error is MissingObject if the value does not exist, with the offset
+ * of the object or array that lacks the member or item.
+ */
+
+JsonTreeModel::JsonTreeModel(const QString &file, const QString &pointer, QJsonParseError *err, LoadOptions opts, QObject *parent) : JsonTreeModel(parent)
 {
   QFile jsonFile(file);
-  QJsonDocument rootDoc;
-  QByteArray jsonContents;
+  QStringList tokens;
+  QVector<qint64> offsets;
+  QJsonValue value;
+  QSharedPointer<RawText> text;
+  QByteArray raw;
+  QVector<bool> objects;
+  uchar *mapped = nullptr;
+
+
+
+  options = opts;
+  if(!JsonPointer::tokens(pointer, &tokens)) {
+      err->error = QJsonParseError::IllegalValue;
+      err->offset = 0;
+      return;
+  }
+
+  if(jsonFile.open(QIODevice::ReadOnly) && !tokens.isEmpty() &&
+     CompressedDevice::detect(&jsonFile) == CompressedDevice::Plain && !CborStreamReader::detect(&jsonFile) &&
+     jsonFile.size() > 0)
+    mapped = jsonFile.map(0, jsonFile.size());
+
+  if(mapped == nullptr) {
+      jsonFile.close();
+      value = readFile(file, err, &text);
+      if(err->error == QJsonParseError::NoError)
+        rebuild(value, text);
+      return;
+  }
+
+  const char *bytes = reinterpret_cast<const char *>(mapped);
+  JsonSkipScanner scanner(bytes, jsonFile.size());
 
+  if(scanner.seek(tokens, &offsets, err)) {
+      qint64 start = offsets.last();
+      qint64 end = scanner.valueEnd(start);
+
+      if(bytes[start] == '{' || bytes[start] == '[') {
+          JsonStreamReader reader(bytes + start, end - start);
+          value = reader.read(err);
+          text = reader.rawText();
+          errorAt = start + reader.offset();
+          err->offset = parseErrorOffset(errorAt);
+          stats.documentBytes = end - start;
+      }
+      else {
+          // A scalar is parsed as the only item of an array.
+          QByteArray item = QByteArray("[") + QByteArray(bytes + start, int(end - start)) + ']';
+          JsonStreamReader reader(item.constData(), item.size());
+          value = reader.read(err).toArray().at(0);
+          if(!reader.rawText().isNull())
+            raw = reader.rawText()->numbers.value(QString("0"));
+          errorAt = start + reader.offset() - 1;
+          err->offset = parseErrorOffset(errorAt);
+          stats.documentBytes = end - start;
+      }
 
+      for(int i = 0; i < tokens.count(); i++)
+        objects.append(bytes[offsets[i]] == '{');
+  }
+  else {
+      errorAt = offsets.last();
+  }
 
-  jsonFile.open(QIODevice::ReadOnly | QIODevice::Text);
-  jsonContents = jsonFile.readAll();
-  rootDoc = QJsonDocument::fromJson(jsonContents, err);
+  jsonFile.unmap(mapped);
   jsonFile.close();
 
-  if(err->error == QJsonParseError::NoError) {
-      if(rootDoc.isObject()) {
-          root = new TreeNode(nullptr, QString("root"), rootDoc.object());
-          traverse(rootDoc.object(), root, 0);
+  if(err->error != QJsonParseError::NoError)
+    return;
+
+  // Build the ancestors from the inside out; each holds only the path,
+  // so the target of an array is its item 0.
+  for(int i = tokens.count() - 1; i >= 0; i--) {
+      QString name = objects[i] ? tokens[i] : QString("0");
+
+      if(!raw.isEmpty() || !text.isNull()) {
+          QSharedPointer<RawText> outer = QSharedPointer<RawText>::create();
+          if(!raw.isEmpty())
+            outer->numbers.insert(name, raw);
+          if(!text.isNull())
+            outer->children.insert(name, text);
+          text = outer;
+          raw.clear();
+      }
+
+      if(objects[i]) {
+          QJsonObject jobj;
+          jobj.insert(tokens[i], value);
+          value = jobj;
       }
       else {
-          root = new TreeNode(nullptr, QString("root"), rootDoc.array());
-          if(rootDoc.isArray())
-            traverse(rootDoc.array(), root, 0);
+          value = QJsonArray{value};
       }
   }
 
+  rebuild(value, text);
+
+  // Columnar arrays are not populated by traverse().
+  seekPath.append(tree.root());
+  for(int i = 0; i < tokens.count(); i++) {
+      TreeNode *node = seekPath.last();
+      if(!node->populated)
+        populate(node);
+      seekPath.append(node->children.first());
+  }
+
+  sourceFile = file;
+  seekTokens = tokens;
 }
 
+
 /**
- * @brief JsonTreeModel::~JsonTreeModel
+ * @brief JsonTreeModel::rebuild
  *
- * If a root document was allocated, it is deleted.
+ * Replace the tree with the TreeNodes of a new document. The caller
+ * resets the model if it is shown.
  *
+ * @param value: The top-level value
+ * @param text: The texts of its numbers, as read
+ * @param ranges: Members of value that are only in the file, from a shallow
+ * read; only the top level is built then
  */
 
-JsonTreeModel::~JsonTreeModel()
+void JsonTreeModel::rebuild(const QJsonValue &value, const QSharedPointer<RawText> &text, const QHash<QString, SourceRange> &ranges)
 {
-  if(root != nullptr)
-    freeTraverse(root);
+  TreeNode *top = new TreeNode(nullptr, QString("root"), value);
+
+
+  tree.reset(top);
+  stats = MemoryStats{1, 1, 0, 0, 0, stats.evictions, stats.refaults, stats.documentBytes, 0};
+  top->rawText = text;
+  top->pending = ranges;
+  if(ranges.isEmpty()) {
+      traverse(top);
+  }
+  else {
+      populate(top);
+      stats.logicalNodes += top->children.count();
+  }
+
+  // The canonical values are only needed while building.
+  shareTable.clear();
+  computeAllStats();
 }
 
 
-bool JsonTreeModel::isModified()
+/**
+ * @brief JsonTreeModel::isPartial
+ * @return Returns true if only the value of a JSON Pointer and the path to it
+ * were loaded; see loadRest().
+ */
+
+bool JsonTreeModel::isPartial() const
 {
-  return modified;
+  return !seekPath.isEmpty();
 }
 
 
-void JsonTreeModel::resetModified()
+/**
+ * @brief JsonTreeModel::onSeekPath
+ * @return Returns true if node is the root, an ancestor or the target of a
+ * partial document.
+ */
+
+bool JsonTreeModel::onSeekPath(TreeNode *node) const
 {
-  modified = false;
+  return seekPath.contains(node);
 }
 
 
 /**
- * @brief JsonTreeModel::indent
+ * @brief JsonTreeModel::loadRest
  *
- * Utility function that creates a string to use for padding.
- * Used when printing out the tree, the pad string can indent the node value
- * according to its depth in the tree.
+ * Read the whole file of a partial document, and put the current value of
+ * the target, with its edits, in its place. The tree is built again, so the
+ * model is reset.
  *
- * @param level: Current level of a node in the tree.
+ * @param err: Receives the parse error, if any
+ * @return Returns false if the file could not be read, or during a
+ * transaction; the model stays partial then.
+ */
+
+bool JsonTreeModel::loadRest(QJsonParseError *err)
+{
+  QSharedPointer<RawText> text;
+  QVector<QJsonValue> path;
+
+
+  err->error = QJsonParseError::NoError;
+  err->offset = 0;
+  if(!isPartial())
+    return true;
+
+  if(transactionOpen)
+    return false;
+
+  QJsonValue value = readFile(sourceFile, err, &text);
+  if(err->error != QJsonParseError::NoError)
+    return false;
+
+  // The containers on the path, from the top-level value down.
+  path.append(value);
+  for(const QString &token : seekTokens) {
+      QJsonValue v = path.last();
+
+      // The file was changed since it was opened.
+      if((v.isObject() && !v.toObject().contains(token)) || (v.isArray() && token.toInt() >= v.toArray().size()) ||
+         (!v.isObject() && !v.isArray())) {
+          err->error = QJsonParseError::MissingObject;
+          return false;
+      }
+      path.append(v.isObject() ? v.toObject().value(token) : v.toArray().at(token.toInt()));
+  }
+
+  // Replace the target and copy the containers back up.
+  TreeNode *target = seekPath.last();
+  QJsonValue child = target->data;
+  for(int i = seekTokens.count() - 1; i >= 0; i--) {
+      if(path[i].isObject()) {
+          QJsonObject jobj = path[i].toObject();
+          jobj.insert(seekTokens[i], child);
+          child = jobj;
+      }
+      else {
+          QJsonArray jarr = path[i].toArray();
+          jarr[seekTokens[i].toInt()] = child;
+          child = jarr;
+      }
+  }
+
+  // The same for the number texts.
+  if(text.isNull())
+    text = QSharedPointer<RawText>::create();
+  RawText *outer = text.data();
+  for(int i = 0; i < seekTokens.count() - 1; i++) {
+      QSharedPointer<RawText> &inner = outer->children[seekTokens[i]];
+      if(inner.isNull())
+        inner = QSharedPointer<RawText>::create();
+      outer = inner.data();
+  }
+  QSharedPointer<RawText> targetText = collectRawText(target);
+  outer->numbers.remove(seekTokens.last());
+  outer->children.remove(seekTokens.last());
+  if(!target->raw.isEmpty() && target->data.isDouble())
+    outer->numbers.insert(seekTokens.last(), target->raw);
+  else if(!targetText.isNull())
+    outer->children.insert(seekTokens.last(), targetText);
+
+  beginResetModel();
+  seekPath.clear();
+  seekTokens.clear();
+  originals.clear();
+  documentVersion++;
+  rebuild(child, text);
+  violations.clear();
+  edits.clear();
+  fullValidation = !schema.isNull();
+  endResetModel();
+  startValidation();
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::indexForPointer
  *
- * @return Returns a string with 2 spaces for each level.
+ * Find the item of a JSON Pointer, building the items on the path to it.
+ *
+ * @param pointer: JSON Pointer, e.g. "/store/books/3"
+ * @return Returns the index of the item; an invalid index if there is no such
+ * item or it is hidden by a filter, or for the top-level value.
  */
 
-std::string JsonTreeModel::indent(int level)
+QModelIndex JsonTreeModel::indexForPointer(const QString &pointer)
 {
-  std::string s;
-  for(int i=0; i<level; i++)
-    s += "  ";
+  QStringList tokens;
+  TreeNode *node = tree.root();
 
-  return s;
+
+  if(tree.root() == nullptr || !JsonPointer::tokens(pointer, &tokens))
+    return QModelIndex();
+
+  for(int depth = 0; depth < tokens.count(); depth++) {
+      const QString &token = tokens[depth];
+      TreeNode *next = nullptr;
+
+      if(!node->populated)
+        fetchMore(indexFromNode(node));
+
+      if(node->data.isObject()) {
+          for(auto child : node->children) {
+              if(child->key == token) {
+                  next = child;
+                  break;
+              }
+          }
+      }
+      else if(node->data.isArray() && onSeekPath(node) && node != seekPath.last()) {
+          // A partial array holds only the item on the path.
+          if(seekTokens.value(depth) == token)
+            next = node->children.value(0);
+      }
+      else if(node->data.isArray()) {
+          int i;
+          if(JsonPointer::arrayIndex(token, &i))
+            next = node->children.value(i);
+      }
+
+      if(next == nullptr)
+        return QModelIndex();
+      node = next;
+  }
+
+  return indexFromNode(node);
+}
+
+
+/**
+ * @brief JsonTreeModel::setSchema
+ *
+ * Validate the document against a schema, on a worker thread, and keep it
+ * validated: after each edit only what the edit can affect is checked
+ * again (see JsonSchema::revalidate()), from a snapshot of the document, so
+ * the view is never blocked. The results are shown with Qt::DecorationRole
+ * and Qt::ToolTipRole, and returned by ViolationsRole; validated() is
+ * emitted whenever they change. Partial documents are validated once the
+ * rest is loaded.
+ *
+ * @param compiled: The schema; a null schema ends the validation
+ */
+
+void JsonTreeModel::setSchema(const JsonSchema &compiled)
+{
+  bool shown = !violations.isEmpty();
+
+
+  schema = compiled;
+  violations.clear();
+  edits.clear();
+  fullValidation = !schema.isNull();
+
+  if(shown && tree.root() != nullptr && rowCount() > 0)
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+  startValidation();
+}
+
+
+/**
+ * @brief JsonTreeModel::hasSchema
+ * @return Returns true if the document is validated against a schema.
+ */
+
+bool JsonTreeModel::hasSchema() const
+{
+  return !schema.isNull();
+}
+
+
+/**
+ * @brief JsonTreeModel::violationCount
+ * @return Returns the number of values with schema violations, as of the
+ * last validation results.
+ */
+
+int JsonTreeModel::violationCount() const
+{
+  return violations.count();
+}
+
+
+/**
+ * @brief JsonTreeModel::violationsOf
+ * @param pointer: JSON Pointer of a value; "" for the top-level value
+ * @return Returns the schema violations found at the value.
+ */
+
+QStringList JsonTreeModel::violationsOf(const QString &pointer) const
+{
+  return violations.value(pointer);
+}
+
+
+/**
+ * @brief JsonTreeModel::pathOf
+ * @param node: A node of the tree
+ * @return Returns the keys and array indices from the root to node.
+ */
+
+QStringList JsonTreeModel::pathOf(TreeNode *node) const
+{
+  QStringList path;
+
+
+  for(TreeNode *n = node; n != nullptr && n->parent != nullptr; n = n->parent) {
+      int depth = seekPath.indexOf(n);
+      if(n->parent->data.isObject())
+        path.prepend(n->key);
+      else
+        path.prepend(depth > 0 ? seekTokens[depth - 1] : QString::number(n->pos));
+  }
+
+  return path;
+}
+
+
+/**
+ * @brief JsonTreeModel::nodeForPath
+ * @param path: Keys and array indices from the root
+ * @return Returns the node of the path, if it is built; nullptr otherwise.
+ */
+
+TreeNode *JsonTreeModel::nodeForPath(const QStringList &path) const
+{
+  return TreeCore::find(tree.root(), path, false);
+}
+
+
+/**
+ * @brief JsonTreeModel::noteEdit
+ *
+ * Queue the revalidation of an edited value.
+ *
+ * @param node: The edited node; for renamed members and inserted, removed
+ * or moved children, their parent
+ */
+
+void JsonTreeModel::noteEdit(TreeNode *node)
+{
+  if(schema.isNull() || node == nullptr)
+    return;
+
+  edits.append(pathOf(node));
+  startValidation();
+}
+
+
+/**
+ * @brief JsonTreeModel::startValidation
+ *
+ * Validate a snapshot of the document on a worker thread: all of it after
+ * setSchema(), or what the queued edits affect. One run is active at a
+ * time; edits made meanwhile are queued for the next one. While values are
+ * only in the file (see setMemoryBudget()), the edits are only queued.
+ */
+
+void JsonTreeModel::startValidation()
+{
+  if(validating || schema.isNull() || tree.root() == nullptr || isPartial() || (!fullValidation && edits.isEmpty()))
+    return;
+
+  // Reading the rest of the file would exceed the memory budget.
+  if(!rangeFile.isEmpty() && sourceBytes(tree.root()) > 0)
+    return;
+
+  JsonSchema compiled = schema;
+  JsonSnapshot snap = snapshot();
+  QVector<QStringList> paths = edits;
+  bool full = fullValidation;
+
+  validating = true;
+  fullValidation = false;
+  edits.clear();
+  validation->setFuture(QtConcurrent::run([compiled, snap, paths, full]() {
+      SchemaViolations result = full ? compiled.validate(snap.root()) : compiled.revalidate(snap.root(), paths);
+      result.version = snap.version();
+      return result;
+  }));
+}
+
+
+/**
+ * @brief JsonTreeModel::validationFinished
+ *
+ * Merge the results of a validation run, update the items whose violations
+ * changed, and start the next run if edits were queued.
+ */
+
+void JsonTreeModel::validationFinished()
+{
+  SchemaViolations result = validation->result();
+  QSet<QString> changed;
+
+
+  validating = false;
+  if(schema.isNull() || tree.root() == nullptr) {
+      startValidation();
+      return;
+  }
+
+  if(result.full) {
+      for(auto it = violations.constBegin(); it != violations.constEnd(); ++it)
+        changed.insert(it.key());
+  }
+  else {
+      for(const QString &pointer : result.ancestors + result.subtrees) {
+          changed.insert(pointer);
+          auto it = violations.lowerBound(pointer + '/');
+          for(; it != violations.end() && it.key().startsWith(pointer + '/'); ++it)
+            changed.insert(it.key());
+      }
+  }
+  for(auto it = result.found.constBegin(); it != result.found.constEnd(); ++it)
+    changed.insert(it.key());
+
+  result.applyTo(&violations);
+
+  for(const QString &pointer : changed) {
+      QStringList path;
+      JsonPointer::tokens(pointer, &path);
+      TreeNode *node = nodeForPath(path);
+      if(node != nullptr && node != tree.root()) {
+          QModelIndex index = indexFromNode(node);
+          if(index.isValid())
+            emit dataChanged(index, index.sibling(index.row(), columnCount() - 1));
+      }
+  }
+
+  emit validated(violations.count());
+  startValidation();
+}
+
+
+/**
+ * @brief JsonTreeModel::startJournal
+ *
+ * Record every edit from now on in the journal of a file (see EditJournal),
+ * so that they can be recovered with recoverJournal() if the program
+ * crashes before they are saved. Called after the document is opened, and
+ * again after each save, which makes the previous journal obsolete; it is
+ * deleted. Journals are not kept for partial documents.
+ *
+ * @param file: Name of the file the document was opened from or saved to
+ * @param error: Receives the reason if the journal cannot be written
+ * @return Returns true if the journal was started.
+ */
+
+bool JsonTreeModel::startJournal(const QString &file, QString *error)
+{
+  if(isPartial()) {
+      *error = QString("Load the rest of the document first");
+      return false;
+  }
+
+  sourceFile = file;
+  return journal->start(file, error);
+}
+
+
+/**
+ * @brief JsonTreeModel::stopJournal
+ *
+ * Stop recording edits and delete the journal, e.g. when the edits are
+ * discarded. The journal is also deleted with the model.
+ */
+
+void JsonTreeModel::stopJournal()
+{
+  journal->stop();
+}
+
+
+/**
+ * @brief JsonTreeModel::recoverJournal
+ *
+ * Replay the edits recorded in the journal of the file the document was
+ * opened from, after a crash; see EditJournal::canRecover(). The edits are
+ * made through the same functions that recorded them, so they have the same
+ * effect, and are recorded again in a new journal. Replaying before the model
+ * is shown in a view avoids updating the view for every edit.
+ *
+ * @param error: Receives the reason if the journal cannot be read
+ * @return Returns the number of edits replayed; -1 on error.
+ */
+
+int JsonTreeModel::recoverJournal(QString *error)
+{
+  int count = 0;
+
+
+  error->clear();
+  QVector<QJsonArray> records = EditJournal::records(sourceFile, error);
+  if(!error->isEmpty() || !startJournal(sourceFile, error))
+    return -1;
+
+  for(const QJsonArray &record : records)
+    if(replay(record))
+      count++;
+
+  // The session crashed during a transaction.
+  rollbackTransaction();
+  return count;
+}
+
+
+/**
+ * @brief JsonTreeModel::replay
+ *
+ * Make one edit recorded in a journal. The first item of the record names
+ * the function, followed by the paths (keys and indices, from the root) of
+ * the items it was called on and its other arguments:
+ *
+ * - ["key", path, key] and ["value", path, value]: setData()
+ * - ["insert", path, row, count] and ["remove", path, row, count]: insertRows() and removeRows()
+ * - ["move", path, row, count, path, row]: moveRows()
+ * - ["cell", path, row, column, value]: setCell()
+ * - ["begin"], ["commit"] and ["rollback"]: the transaction functions
+ *
+ * @param record: The record
+ * @return Returns true if the edit was made.
+ */
+
+bool JsonTreeModel::replay(const QJsonArray &record)
+{
+  QString op = record.at(0).toString();
+  QStringList path;
+
+
+  for(const QJsonValue &token : record.at(1).toArray())
+    path.append(token.toString());
+
+  if(op == "begin")
+    return beginTransaction();
+  if(op == "commit")
+    return commitTransaction();
+  if(op == "rollback") {
+      rollbackTransaction();
+      return true;
+  }
+
+  QModelIndex item = indexForPointer(JsonPointer::fromTokens(path));
+  if(!item.isValid() && !path.isEmpty())
+    return false;
+
+  if(op == "key")
+    return setData(item.sibling(item.row(), KeyColumn), record.at(2).toVariant());
+  if(op == "value")
+    return setData(item.sibling(item.row(), ValueColumn), record.at(2).toVariant());
+  if(op == "insert")
+    return insertRows(record.at(2).toInt(), record.at(3).toInt(), item);
+  if(op == "remove")
+    return removeRows(record.at(2).toInt(), record.at(3).toInt(), item);
+  if(op == "cell")
+    return setCell(item, record.at(2).toInt(), record.at(3).toInt(), record.at(4).toVariant());
+
+  if(op == "move") {
+      QStringList destination;
+      for(const QJsonValue &token : record.at(4).toArray())
+        destination.append(token.toString());
+
+      QModelIndex target = indexForPointer(JsonPointer::fromTokens(destination));
+      if(!target.isValid() && !destination.isEmpty())
+        return false;
+      return moveRows(item, record.at(2).toInt(), record.at(3).toInt(), target, record.at(5).toInt());
+  }
+
+  return false;
+}
+
+
+/**
+ * @brief JsonTreeModel::~JsonTreeModel
+ *
+ * The document tree, if any, is deleted with its TreeCore.
+ *
+ */
+
+JsonTreeModel::~JsonTreeModel()
+{
+}
+
+
+bool JsonTreeModel::isModified()
+{
+  return modified;
+}
+
+
+void JsonTreeModel::resetModified()
+{
+  modified = false;
+}
+
+
+/**
+ * @brief JsonTreeModel::memoryStats
+ *
+ * With the Deduplicate load option, @c materializedNodes is smaller than
+ * @c logicalNodes by roughly the repetition factor of the document.
+ * It grows again as shared subtrees are expanded in the view. With the
+ * OnDemand option, @c logicalNodes counts the values read so far.
+ *
+ * @return Returns the current node counts and sizes of the model.
+ */
+
+JsonTreeModel::MemoryStats JsonTreeModel::memoryStats() const
+{
+  MemoryStats current = stats;
+
+
+  current.sourceBytes = sourceBytes(tree.root());
+  return current;
+}
+
+
+/**
+ * @brief JsonTreeModel::core
+ *
+ * The document tree, for tools that walk the built nodes without the
+ * QAbstractItemModel interface (see TreeCore::visit()).
+ *
+ * @return Returns the tree of TreeNodes.
+ */
+
+const TreeCore &JsonTreeModel::core() const
+{
+  return tree;
+}
+
+
+/**
+ * @brief JsonTreeModel::indent
+ *
+ * Utility function that creates a string to use for padding.
+ * Used when printing out the tree, the pad string can indent the node value
+ * according to its depth in the tree.
+ *
+ * @param level: Current level of a node in the tree.
+ *
+ * @return Returns a string with 2 spaces for each level.
+ */
+
+std::string JsonTreeModel::indent(int level)
+{
+  std::string s;
+  for(int i=0; i<level; i++)
+    s += "  ";
+
+  return s;
+}
+
+
+/**
+ * @brief mapSource
+ *
+ * Map part of the file that a document was read from on demand, if it is
+ * still the file as it was read: same size and modification time.
+ *
+ * @param file: The file, not open yet
+ * @param size: Its size when it was read
+ * @param time: Its modification time when it was read
+ * @param range: The bytes to map
+ * @return Returns the mapped bytes; nullptr if the file changed or cannot be read.
+ */
+
+static uchar *mapSource(QFile *file, qint64 size, const QDateTime &time, const SourceRange &range)
+{
+  QFileInfo info(*file);
+  uchar *mapped = nullptr;
+
+
+  if(info.size() == size && info.lastModified() == time && file->open(QIODevice::ReadOnly))
+    mapped = file->map(range.start, range.end - range.start);
+
+  if(mapped == nullptr)
+    qWarning("%s changed or cannot be read", qPrintable(file->fileName()));
+  return mapped;
+}
+
+
+/**
+ * @brief JsonTreeModel::toJsonDocument
+ * @return Returns a QJsonDocument that is constructed from the current
+ * tree structure; see document().
+ */
+
+QJsonDocument JsonTreeModel::toJsonDocument()
+{
+  QJsonValue value = document(nullptr);
+
+
+  if(value.type() == QJsonValue::Array)
+    return QJsonDocument(value.toArray());
+  else if(value.type() == QJsonValue::Object)
+    return QJsonDocument(value.toObject());
+  else
+    return QJsonDocument();
+}
+
+
+/**
+ * @brief JsonTreeModel::snapshot
+ *
+ * Take a read-only copy of the document for another thread, in constant
+ * time; see JsonSnapshot. Edits of an open transaction are not included
+ * until they are committed. Number texts (TreeNode::raw) are not included.
+ * Values that are only in the file are read back into the copy first (see
+ * document()), which takes as long, and as much memory, as they need.
+ *
+ * @return Returns the snapshot; a null snapshot if there is no document,
+ * or if values cannot be read back from the file.
+ */
+
+JsonSnapshot JsonTreeModel::snapshot() const
+{
+  QJsonValue value = document(nullptr);
+
+
+  if(value.isUndefined())
+    return JsonSnapshot();
+
+  return JsonSnapshot(documentVersion, value);
+}
+
+
+/**
+ * @brief JsonTreeModel::document
+ *
+ * The whole document: the value of the root, with the values that are only
+ * in the file read back into it (see readUnloaded()). The tree is left as
+ * it is. Without such values, this is the value of the root.
+ *
+ * @param text: If not null, receives the number texts of the document; see collectRawText()
+ * @return Returns the top-level value; undefined if there is no document, or
+ * if values cannot be read back from the file.
+ */
+
+QJsonValue JsonTreeModel::document(QSharedPointer<RawText> *text) const
+{
+  QHash<TreeNode *, QJsonValue> values;
+  QHash<TreeNode *, QSharedPointer<RawText>> texts;
+  TreeNode *top = tree.root();
+
+
+  if(top == nullptr || !readUnloaded(&values, &texts))
+    return QJsonValue(QJsonValue::Undefined);
+
+  if(!values.contains(top)) {
+      if(text != nullptr)
+        *text = collectRawText(top);
+      return top->data;
+  }
+
+  if(text != nullptr)
+    *text = texts.value(top);
+  return values.value(top);
+}
+
+
+/**
+ * @brief JsonTreeModel::readUnloaded
+ *
+ * Read back the values that are only in the file: those of the unloaded
+ * nodes and of the pending members. The containers above them get their
+ * whole value, built from the inside out so that each is copied once,
+ * together with its number texts. The tree is not changed.
+ *
+ * @param values: Receives the whole value of each unloaded node, of each
+ * node with pending members, and of their ancestors
+ * @param texts: Receives the number texts of the same nodes, as
+ * collectRawText() would; null for nodes without any
+ * @return Returns false if the file changed or cannot be read.
+ */
+
+bool JsonTreeModel::readUnloaded(QHash<TreeNode *, QJsonValue> *values, QHash<TreeNode *, QSharedPointer<RawText>> *texts) const
+{
+  QSet<TreeNode *> outside;
+  QVector<TreeNode *> order;
+  QFile file(rangeFile);
+  bool ok = true;
+
+
+  if(tree.root() == nullptr || rangeFile.isEmpty())
+    return true;
+
+  TreeCore::visit(tree.root(), [&outside](TreeNode *node, int) {
+      if(node->unloaded || !node->pending.isEmpty())
+        for(TreeNode *n = node; n != nullptr && !outside.contains(n); n = n->parent)
+          outside.insert(n);
+      return true;
+  });
+
+  if(outside.isEmpty())
+    return true;
+
+  // Containers come before the nodes inside them.
+  TreeCore::visit(tree.root(), [&outside, &order](TreeNode *node, int) {
+      if(!outside.contains(node))
+        return false;
+      order.append(node);
+      return true;
+  });
+
+  uchar *mapped = mapSource(&file, rangeSize, rangeTime, SourceRange(0, rangeSize));
+  if(mapped == nullptr)
+    return false;
+
+  const char *bytes = reinterpret_cast<const char *>(mapped);
+  auto read = [bytes](const SourceRange &range, QJsonValue *value, QSharedPointer<RawText> *text) {
+      QJsonParseError err;
+      JsonStreamReader reader(bytes + range.start, range.end - range.start);
+      *value = reader.read(&err);
+      *text = reader.rawText();
+      return err.error == QJsonParseError::NoError;
+  };
+
+  for(int i = order.count() - 1; i >= 0 && ok; i--) {
+      TreeNode *node = order[i];
+      QJsonObject jobj = node->data.toObject();
+      QJsonArray jarr = node->data.toArray();
+      QJsonValue value;
+      QSharedPointer<RawText> text;
+
+      if(node->unloaded) {
+          ok = read(node->range, &value, &text);
+          values->insert(node, value);
+          texts->insert(node, text);
+          continue;
+      }
+
+      QSharedPointer<RawText> whole = QSharedPointer<RawText>::create();
+      auto put = [node, &jobj, &jarr, &whole](const QString &name, const QJsonValue &member, const QSharedPointer<RawText> &memberText) {
+          if(node->data.isObject())
+            jobj.insert(name, member);
+          else
+            jarr[name.toInt()] = member;
+          if(!memberText.isNull())
+            whole->children.insert(name, memberText);
+      };
+
+      if(!node->populated) {
+          if(!node->rawText.isNull())
+            *whole = *node->rawText;
+          for(auto it = node->pending.constBegin(); it != node->pending.constEnd() && ok; ++it) {
+              ok = read(it.value(), &value, &text);
+              put(it.key(), value, text);
+          }
+      }
+
+      for(auto child : node->children) {
+          QString name = node->data.isObject() ? child->key : QString::number(child->pos);
+          if(outside.contains(child))
+            put(name, values->value(child), texts->value(child));
+          else if(!child->raw.isEmpty() && child->data.isDouble())
+            whole->numbers.insert(name, child->raw);
+          else if(child->data.isObject() || child->data.isArray()) {
+              QSharedPointer<RawText> childText = collectRawText(child);
+              if(!childText.isNull())
+                whole->children.insert(name, childText);
+          }
+      }
+
+      if(whole->numbers.isEmpty() && whole->children.isEmpty())
+        whole.reset();
+      values->insert(node, node->data.isObject() ? QJsonValue(jobj) : QJsonValue(jarr));
+      texts->insert(node, whole);
+  }
+
+  file.unmap(mapped);
+  if(!ok)
+    qWarning("%s changed and cannot be read back", qPrintable(rangeFile));
+  return ok;
+}
+
+
+/**
+ * @brief JsonTreeModel::version
+ *
+ * The version is incremented by every change of the document that reaches
+ * the root, so a worker can tell whether the result it computed from a
+ * snapshot is still current.
+ *
+ * @return Returns the version of the document.
+ */
+
+quint64 JsonTreeModel::version() const
+{
+  return documentVersion;
+}
+
+
+/**
+ * @brief JsonTreeModel::write
+ *
+ * Write the document to a device, as JSON with JsonStreamWriter, indented like
+ * QJsonDocument::toJson(), or as CBOR with CborStreamWriter. Numbers are
+ * written with the text they were read or typed with when it differs from the
+ * default formatting; in CBOR, only integers keep their exact value.
+ *
+ * @param dev: An open device
+ * @param fmt: The encoding to write
+ * @return Returns false if the device could not be written, or if the
+ * document is partial.
+ */
+
+bool JsonTreeModel::write(QIODevice *dev, FileFormat fmt)
+{
+  QSharedPointer<RawText> text;
+
+
+  // Only the path was read; see loadRest().
+  if(isPartial())
+    return false;
+
+  QJsonValue value = document(&text);
+  if(value.isUndefined())
+    return false;
+
+  QJsonDocument doc = value.isArray() ? QJsonDocument(value.toArray()) : QJsonDocument(value.toObject());
+  if(fmt == CborFormat)
+    return CborStreamWriter::write(dev, doc, text);
+
+  return JsonStreamWriter::write(dev, doc, text);
+}
+
+
+/**
+ * @brief JsonTreeModel::releaseFile
+ *
+ * Read back every value that is only in a file before the file is
+ * overwritten, e.g. by saving to it. The document is then held in memory
+ * whole, and the memory budget only frees TreeNodes, until a file is
+ * opened again.
+ *
+ * @param file: The file about to be written
+ * @return Returns false if the values could not be read back; true if
+ * none are read from this file.
+ */
+
+bool JsonTreeModel::releaseFile(const QString &file)
+{
+  QHash<TreeNode *, QJsonValue> values;
+  QHash<TreeNode *, QSharedPointer<RawText>> texts;
+  QString target = QFileInfo(file).canonicalFilePath();
+
+
+  if(rangeFile.isEmpty() || target.isEmpty() || target != QFileInfo(rangeFile).canonicalFilePath())
+    return true;
+
+  if(!readUnloaded(&values, &texts))
+    return false;
+
+  for(auto it = values.constBegin(); it != values.constEnd(); ++it) {
+      TreeNode *node = it.key();
+      node->data = it.value();
+      if(!node->populated)
+        node->rawText = texts.value(node);
+      node->unloaded = false;
+      node->pending.clear();
+  }
+
+  TreeCore::visit(tree.root(), [](TreeNode *node, int) {
+      node->range = SourceRange();
+      return true;
+  });
+  rangeFile.clear();
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::fileFormat
+ * @return Returns the encoding of the file the document was read from.
+ */
+
+JsonTreeModel::FileFormat JsonTreeModel::fileFormat() const
+{
+  return format;
+}
+
+
+/**
+ * @brief JsonTreeModel::errorOffset
+ * @return Returns the byte offset of the error the file was last read with.
+ * QJsonParseError::offset is an int, clamped for files beyond 2 GiB; this
+ * is the exact offset.
+ */
+
+qint64 JsonTreeModel::errorOffset() const
+{
+  return errorAt;
+}
+
+
+/**
+ * @brief JsonTreeModel::formatForFile
+ *
+ * @param file: A file name
+ * @return Returns CborFormat for names ending in .cbor, also before a
+ * compression suffix such as .gz; JsonFormat otherwise.
+ */
+
+JsonTreeModel::FileFormat JsonTreeModel::formatForFile(const QString &file)
+{
+  QString name = file;
+
+
+  if(CompressedDevice::formatForFile(name) != CompressedDevice::Plain)
+    name.truncate(name.lastIndexOf('.'));
+
+  return name.endsWith(".cbor", Qt::CaseInsensitive) ? CborFormat : JsonFormat;
+}
+
+
+/**
+ * @brief JsonTreeModel::collectRawText
+ *
+ * Gather the number texts held by a subtree into one RawText: TreeNode::raw
+ * of the built leaves, and TreeNode::rawText of the containers that are not
+ * populated. Only the paths to such nodes get a RawText.
+ *
+ * @param top: Root of the subtree
+ * @return Returns the RawText of top; null if no number needs its text.
+ */
+
+QSharedPointer<RawText> JsonTreeModel::collectRawText(TreeNode *top) const
+{
+  QHash<TreeNode *, QSharedPointer<RawText>> texts;
+  QVector<TreeNode *> stack;
+
+
+  if(top == nullptr)
+    return QSharedPointer<RawText>();
+
+  if(!top->populated)
+    return top->rawText;
+
+  auto name = [](TreeNode *node) {
+      return node->parent->data.isObject() ? node->key : QString::number(node->pos);
+  };
+
+  // Returns the RawText of a container, linking new ones up to the root.
+  auto textOf = [&texts, &name, top](TreeNode *node) {
+      QVector<TreeNode *> path;
+      TreeNode *n = node;
+
+      while(n != top->parent && !texts.contains(n)) {
+          path.append(n);
+          n = n->parent;
+      }
+
+      QSharedPointer<RawText> text = (n == top->parent) ? QSharedPointer<RawText>() : texts.value(n);
+      for(int i = path.count() - 1; i >= 0; i--) {
+          QSharedPointer<RawText> created = QSharedPointer<RawText>::create();
+          if(!text.isNull())
+            text->children.insert(name(path[i]), created);
+          texts.insert(path[i], created);
+          text = created;
+      }
+      return text;
+  };
+
+  stack.append(top);
+  while(!stack.isEmpty()) {
+      TreeNode *node = stack.takeLast();
+
+      for(auto child : node->children) {
+          if(!child->raw.isEmpty() && child->data.isDouble())
+            textOf(node)->numbers.insert(name(child), child->raw);
+          else if(!child->populated && !child->rawText.isNull())
+            textOf(node)->children.insert(name(child), child->rawText);
+          else if(child->populated && !child->children.isEmpty())
+            stack.append(child);
+      }
+  }
+
+  return texts.value(top);
+}
+
+
+/**
+ * @brief JsonTreeModel::freeTraverse
+ *
+ * Delete node and its subtree with TreeCore::free(), and count the nodes
+ * as no longer materialized.
+ *
+ * @param node: Node at which to start the traversal.
+ *
+ */
+
+void JsonTreeModel::freeTraverse(TreeNode *node)
+{
+  stats.materializedNodes -= TreeCore::free(node);
+}
+
+
+/**
+ * @brief JsonTreeModel::releaseTree
+ *
+ * Hand the document tree over to a worker thread, which frees it, and leave
+ * the model empty. Used before deleting a model that is no longer shown,
+ * so that the GUI thread does not wait for a large tree to be freed.
+ */
+
+void JsonTreeModel::releaseTree()
+{
+  if(tree.root() == nullptr)
+    return;
+
+  beginResetModel();
+  TreeNode *released = tree.release();
+  documentVersion++;
+  originals.clear();
+  seekPath.clear();
+  violations.clear();
+  edits.clear();
+  transactionOpen = false;
+  stats.materializedNodes = 0;
+  endResetModel();
+
+  QtConcurrent::run([released]() { TreeCore::free(released); });
+}
+
+
+/**
+ * @brief JsonTreeModel::setMemoryBudget
+ *
+ * Limit the memory held by the document. When it exceeds the budget,
+ * collapsed subtrees are evicted, least recently used first, until it is met
+ * again; see evict(). The memory is estimated as the size of the JSON text
+ * of the values held, plus the TreeNodes built.
+ *
+ * The values of a document opened with the OnDemand load option are read
+ * from the file as they are expanded, and evicted subtrees go back to the
+ * file, so the memory stays within the budget whatever the size of the file.
+ * Other documents are held whole; evicting only frees their TreeNodes.
+ *
+ * @param bytes: The budget; 0 for no limit
+ */
+
+void JsonTreeModel::setMemoryBudget(qint64 bytes)
+{
+  budget = qMax(bytes, qint64(0));
+  enforceBudget();
+}
+
+
+/**
+ * @brief JsonTreeModel::memoryBudget
+ * @return Returns the memory budget in bytes; 0 if there is no limit.
+ */
+
+qint64 JsonTreeModel::memoryBudget() const
+{
+  return budget;
+}
+
+
+/**
+ * @brief JsonTreeModel::setExpanded
+ *
+ * Tell the model that the view expanded or collapsed an item. Only
+ * collapsed subtrees are evicted, so the view should report both; items
+ * fetched with fetchMore() count as expanded until they are collapsed.
+ *
+ * @param index: The item
+ * @param expanded: True if the item was expanded
+ */
+
+void JsonTreeModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+  TreeNode *node = nodeFromIndex(index);
+
+
+  if(node == nullptr || node == tree.root())
+    return;
+
+  node->expanded = expanded;
+  node->lastUse = ++useClock;
+  if(!expanded)
+    enforceBudget();
+}
+
+
+/**
+ * @brief JsonTreeModel::sourceBytes
+ * @param node: Root of a subtree; may be nullptr
+ * @return Returns the bytes of text whose values are only in the file, in
+ * the subtree: the ranges of the unloaded nodes and of the pending members.
+ */
+
+qint64 JsonTreeModel::sourceBytes(TreeNode *node) const
+{
+  qint64 bytes = 0;
+
+
+  if(node == nullptr)
+    return 0;
+
+  TreeCore::visit(node, [&bytes](TreeNode *n, int) {
+      if(n->unloaded)
+        bytes += n->range.end - n->range.start;
+      for(const SourceRange &range : n->pending)
+        bytes += range.end - range.start;
+      return true;
+  });
+
+  return bytes;
+}
+
+
+/**
+ * @brief JsonTreeModel::residentBytes
+ * @return Returns the memory held by the document, as measured against the
+ * budget: the text of the values in memory, and the TreeNodes.
+ */
+
+qint64 JsonTreeModel::residentBytes() const
+{
+  return stats.documentBytes - sourceBytes(tree.root()) + stats.materializedNodes * qint64(sizeof(TreeNode));
+}
+
+
+/**
+ * @brief JsonTreeModel::enforceBudget
+ *
+ * Evict collapsed subtrees, least recently used first, until the document
+ * fits in the memory budget. The candidates are the outermost collapsed
+ * containers that are built and visible, and the values read from the
+ * file whose children were never built; nodes below an expanded item are
+ * never freed. Nothing is evicted during a transaction, whose edits are
+ * only held by the nodes.
+ */
+
+void JsonTreeModel::enforceBudget()
+{
+  QVector<TreeNode *> candidates;
+
+
+  if(budget == 0 || tree.root() == nullptr || transactionOpen)
+    return;
+
+  qint64 resident = residentBytes();
+  if(resident <= budget)
+    return;
+
+  TreeCore::visit(tree.root(), [this, &candidates](TreeNode *node, int depth) {
+      if(depth == 0)
+        return true;
+      if(node->row() < 0)
+        return false;
+
+      // The path of a partial document is never freed.
+      if(node->populated && !node->children.isEmpty() &&
+         (node->expanded || (onSeekPath(node) && node != seekPath.last())))
+        return true;
+
+      if((node->populated && !node->children.isEmpty()) || (!node->populated && !node->unloaded && !node->range.isEmpty()))
+        candidates.append(node);
+      return false;
+  });
+
+  std::sort(candidates.begin(), candidates.end(), [](TreeNode *a, TreeNode *b) { return a->lastUse < b->lastUse; });
+
+  for(auto node : candidates) {
+      if(resident <= budget)
+        break;
+
+      qint64 nodes = stats.materializedNodes;
+      qint64 unloaded = sourceBytes(node);
+      if(evict(node))
+        resident -= (nodes - stats.materializedNodes) * qint64(sizeof(TreeNode)) + sourceBytes(node) - unloaded;
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::evict
+ *
+ * Free the children of a collapsed container and leave it unpopulated, as
+ * share() does. If the text of its value in the file is known, the value is
+ * left in the file too (see unload()) and refault() reads it again when the
+ * view expands it. Otherwise the value still holds the subtree, and
+ * populate() builds the children again from it; number texts of the subtree
+ * are kept in TreeNode::rawText, and the members with a known text are left
+ * in the file as pending members.
+ *
+ * Subtrees with a filter or an order that populate() would not restore are
+ * left alone, as are subtrees that hold values only in the file below
+ * members that are not themselves in the file, which could not be found again.
+ *
+ * @param node: The container
+ * @return Returns true if anything was freed.
+ */
+
+bool JsonTreeModel::evict(TreeNode *node)
+{
+  QVector<TreeNode *> stack;
+  bool whole = !node->range.isEmpty() && (node->parent->view == nullptr || node->parent->view->field.isEmpty());
+
+
+  if(!node->populated) {
+      if(!unload(node))
+        return false;
+      node->evicted = true;
+      stats.evictions++;
+      return true;
+  }
+
+  stack.append(node);
+  while(!stack.isEmpty()) {
+      TreeNode *n = stack.takeLast();
+      ChildView *view = n->view;
+
+      if(view != nullptr && (!view->filter.isEmpty() || !view->field.isEmpty() ||
+                             view->column != sortColumn || view->order != sortOrder))
+        return false;
+
+      for(auto child : n->children)
+        stack.append(child);
+  }
+
+  if(!whole)
+    for(auto child : node->children)
+      if(child->range.isEmpty() && sourceBytes(child) > 0)
+        return false;
+
+  QModelIndex index = indexFromNode(node);
+  int rows = rowCount(index);
+  QSharedPointer<RawText> text = whole ? QSharedPointer<RawText>() : collectRawText(node);
+  QJsonObject jobj = node->data.toObject();
+  QJsonArray jarr = node->data.toArray();
+  bool kept = false;
+
+  // Members whose text is known are left in the file.
+  if(!whole) {
+      for(auto child : node->children) {
+          QString name = node->data.isObject() ? child->key : QString::number(child->pos);
+          if(child->range.isEmpty())
+            continue;
+
+          node->pending.insert(name, child->range);
+          if(!text.isNull())
+            text->children.remove(name);
+          if(child->unloaded)
+            continue;
+
+          QJsonValue placeholder = child->data.isObject() ? QJsonValue(QJsonObject()) : QJsonValue(QJsonArray());
+          if(node->data.isObject())
+            jobj.insert(child->key, placeholder);
+          else
+            jarr[child->pos] = placeholder;
+          kept = true;
+      }
+  }
+
+  beginRemoveRows(index, 0, rows - 1);
+  for(auto child : node->children)
+    freeTraverse(child);
+  node->children.clear();
+  delete node->view;
+  node->view = nullptr;
+  node->rawText = text;
+  node->populated = false;
+  node->evicted = true;
+  if(whole) {
+      unload(node);
+  }
+  else if(kept) {
+      node->data = node->data.isObject() ? QJsonValue(jobj) : QJsonValue(jarr);
+      writeUp(node, node->pos, node->key);
+  }
+  endRemoveRows();
+
+  stats.evictions++;
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::unload
+ *
+ * Leave the value of a node whose children are not built in the file it was
+ * read from: data becomes an empty placeholder, which the ancestors take
+ * too, so that nothing holds the value any more. refault() reads it again
+ * from TreeNode::range.
+ *
+ * @param node: The node
+ * @return Returns false if the text of the value is not known, or if the
+ * parent is sorted by a member of its items, which needs the value.
+ */
+
+bool JsonTreeModel::unload(TreeNode *node)
+{
+  if(node->unloaded || node->range.isEmpty() || (node->parent->view != nullptr && !node->parent->view->field.isEmpty()))
+    return false;
+
+  node->data = node->data.isObject() ? QJsonValue(QJsonObject()) : QJsonValue(QJsonArray());
+  node->rawText.reset();
+  node->pending.clear();
+  node->unloaded = true;
+  writeUp(node, node->pos, node->key);
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::addChild
+ *
+ * Allocate a TreeNode for the given key/value and append it to the children of parent,
+ * or insert it before a row. While the parent still has the RawText it was read
+ * with, the new node takes its part of it.
+ *
+ * @param parent: The parent TreeNode
+ * @param key: Key of the new node; empty for array items
+ * @param val: Value of the new node
+ * @param row: Row before which the node is inserted; -1 to append it
+ * @return Returns the new node.
+ */
+
+TreeNode *JsonTreeModel::addChild(TreeNode *parent, const QString &key, const QJsonValue &val, int row)
+{
+  TreeNode *newNode = row < 0 ? TreeCore::addChild(parent, key, val) : TreeCore::insertChild(parent, row, key, val);
+
+  stats.materializedNodes++;
+
+  if(!parent->rawText.isNull()) {
+      QString name = parent->data.isObject() ? key : QString::number(newNode->pos);
+      newNode->raw = parent->rawText->numbers.value(name);
+      newNode->rawText = parent->rawText->children.value(name);
+  }
+  return newNode;
+}
+
+
+/**
+ * @brief hashCombine
+ *
+ * Mix the hash value v into the running hash h. The result depends on the order of the calls.
+ */
+
+static inline uint hashCombine(uint h, uint v)
+{
+  return h ^ (v + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+
+/**
+ * @brief leafHash
+ *
+ * Numbers are hashed by the bits of their double and strings by their text,
+ * without converting the value to a QVariant. 0 and -0 are equal values,
+ * so they hash the same.
+ *
+ * @return Returns the hash of a value that is not an object or array.
+ */
+
+static uint leafHash(const QJsonValue &val)
+{
+  uint h = qHash(int(val.type()));
+
+
+  switch(val.type()) {
+
+    case QJsonValue::Bool:
+      return hashCombine(h, qHash(val.toBool()));
+
+    case QJsonValue::Double: {
+      double d = val.toDouble();
+      quint64 bits;
+      if(d == 0)
+        d = 0;
+      memcpy(&bits, &d, sizeof(bits));
+      return hashCombine(h, qHash(bits));
+    }
+
+    case QJsonValue::String:
+      return hashCombine(h, qHash(val.toString()));
+
+    default:
+      return h;
+  }
+}
+
+
+/**
+ * @brief The SubtreeHash struct
+ *
+ * Structural hash and size of one object or array of a document, computed
+ * by subtreeHashes() before its nodes are built.
+ */
+
+struct SubtreeHash {
+
+  uint    hash;       /**< Structural hash of the subtree */
+  int     containers; /**< Objects and arrays in the subtree, including its root */
+  qint64  values;     /**< Values below the root of the subtree */
+};
+
+
+/**
+ * @brief The HashFrame struct
+ *
+ * One level of the explicit stack used by subtreeHashes().
+ */
+
+struct HashFrame {
+
+  QJsonObject  jobj;  /**< The container, if an object */
+  QJsonArray   jarr;  /**< The container, if an array */
+  QStringList  keys;  /**< Keys of jobj */
+  QString      key;   /**< Key of the container in its parent */
+  int          count; /**< Number of children */
+  int          next;  /**< Index of the next child to hash */
+  int          index; /**< Index of the container in the result */
+  uint         hash;  /**< Structural hash of the children hashed so far */
+  qint64       values; /**< Values below the container so far */
+};
+
+
+/**
+ * @brief subtreeHashes
+ *
+ * Hash every object and array of a value bottom-up, from the QJsonValues
+ * alone, so that JsonTreeModel::traverse() can find a duplicate subtree
+ * before building any of its nodes.
+ *
+ * @param value: The top-level value
+ * @return Returns one SubtreeHash per object or array, in the order in which
+ * traverse() reaches them: depth first, object members by key. The value
+ * itself is the first.
+ */
+
+static QVector<SubtreeHash> subtreeHashes(const QJsonValue &value)
+{
+  QVector<SubtreeHash> result;
+  QVector<HashFrame> stack;
+  auto open = [&result, &stack](const QJsonValue &v, const QString &key) {
+      HashFrame frame;
+      frame.key = key;
+      frame.next = 0;
+      frame.index = result.count();
+      frame.hash = hashCombine(0, v.type());
+      frame.values = 0;
+      if(v.isObject()) {
+          frame.jobj = v.toObject();
+          frame.keys = frame.jobj.keys();
+          frame.count = frame.keys.count();
+      }
+      else {
+          frame.jarr = v.toArray();
+          frame.count = frame.jarr.count();
+      }
+      result.append(SubtreeHash{0, 0, 0});
+      stack.append(frame);
+  };
+
+
+  if(!value.isObject() && !value.isArray())
+    return result;
+
+  open(value, QString());
+  while(!stack.isEmpty()) {
+      HashFrame &top = stack.last();
+
+      if(top.next < top.count) {
+          int i = top.next++;
+          QString key = top.keys.isEmpty() ? QString("") : top.keys[i];
+          QJsonValue child = top.keys.isEmpty() ? top.jarr.at(i) : top.jobj.value(key);
+
+          top.values++;
+          if(child.isObject() || child.isArray())
+            open(child, key);
+          else
+            top.hash = hashCombine(top.hash, hashCombine(qHash(key), leafHash(child)));
+          continue;
+      }
+
+      // All children of the top container are hashed.
+      HashFrame done = top;
+      stack.removeLast();
+      result[done.index] = SubtreeHash{done.hash, result.count() - done.index, done.values};
+
+      if(!stack.isEmpty()) {
+          stack.last().hash = hashCombine(stack.last().hash, hashCombine(qHash(done.key), done.hash));
+          stack.last().values += done.values;
+      }
+  }
+
+  return result;
+}
+
+
+/**
+ * @brief JsonTreeModel::traverse
+ *
+ * Build the subtree of the given node, converting the document from QJson*
+ * objects into TreeNode structures, with TreeCore::build(): depth first,
+ * with an explicit stack, so the depth of the document is only limited by
+ * memory.
+ *
+ * With the Deduplicate load option, the structural hash of every subtree is
+ * computed first with subtreeHashes(), and share() is asked about each object
+ * or array before it is built: a subtree identical to an earlier one gets no
+ * nodes at all, so the duplicates never take memory, not even for a moment.
+ *
+ * With the Columnar load option, homogeneous arrays of objects are stored in a
+ * ColumnStore and left unpopulated; a homogeneous root array gets one TreeNode
+ * per record.
+ *
+ * @param node: Node whose subtree is built
+ */
+
+void JsonTreeModel::traverse(TreeNode *node)
+{
+  QVector<SubtreeHash> hashes;
+  int nextHash = 1;
+  bool dedup = options & Deduplicate;
+
+
+  if(!node->data.isObject() && !node->data.isArray())
+    return;
+
+  if(storeColumns(node)) {
+      populate(node);
+      return;
+  }
+
+  if(dedup)
+    hashes = subtreeHashes(node->data);
+
+  auto make = [this](TreeNode *parent, const QString &key, const QJsonValue &val) {
+      stats.logicalNodes++;
+      return addChild(parent, key, val);
+  };
+
+  // The hashes are in the order containers are reached; a subtree that is
+  // not built skips the hashes of the containers inside it.
+  auto descend = [this, dedup, &hashes, &nextHash](TreeNode *n) {
+      if(!dedup)
+        return !storeColumns(n);
+
+      const SubtreeHash &sub = hashes[nextHash];
+      if(storeColumns(n) || share(n, sub.hash, sub.values)) {
+          nextHash += sub.containers;
+          return false;
+      }
+      nextHash++;
+      return true;
+  };
+
+  // Once its children are built, they hold the number texts of a container.
+  TreeCore::build(node, make, descend, [](TreeNode *done) { done->rawText.reset(); });
+}
+
+
+/**
+ * @brief JsonTreeModel::share
+ *
+ * Hash-consing of subtrees, used with the Deduplicate load option.
+ *
+ * Called before the children of an object or array are built. The first
+ * occurrence of a subtree is recorded under its structural hash and built.
+ * When a later subtree has the same hash and an equal value, no nodes are
+ * built for it: the node keeps only the (implicitly shared) QJsonValue of the
+ * first occurrence, and its children are created level by level by
+ * populate() when the view expands it. Its values are counted as logical
+ * nodes all the same. The subtrees inside a shared one are never reached,
+ * so each shared subtree is counted once.
+ *
+ * Only the expanded path of a shared subtree is ever copied into TreeNodes, so
+ * setData() on such a copy edits private nodes; the value shared by the other
+ * occurrences is left alone by Qt's copy-on-write.
+ *
+ * @param node: Object or array whose children are not built yet
+ * @param hash: Structural hash of its subtree
+ * @param values: Number of values below it
+ * @return Returns true if the node refers to an earlier identical subtree
+ * and must not be built.
+ */
+
+bool JsonTreeModel::share(TreeNode *node, uint hash, qint64 values)
+{
+  if(values == 0)
+    return false;
+
+  for(const QJsonValue &canonical : shareTable.values(hash)) {
+      if(canonical == node->data) {
+          node->data = canonical;
+          node->populated = false;
+          stats.sharedSubtrees++;
+          stats.logicalNodes += values;
+          return true;
+      }
+  }
+
+  shareTable.insert(hash, node->data);
+  return false;
+}
+
+
+/**
+ * @brief JsonTreeModel::populate
+ *
+ * Create the children of a node that is not populated yet, or whose
+ * children were evicted by the memory budget; an unloaded value is read
+ * from the file first. Only one level is built; child containers are left
+ * unpopulated in turn, and the pending members become unloaded children.
+ *
+ * @param node: The node to populate
+ */
+
+void JsonTreeModel::populate(TreeNode *node)
+{
+  if(!refault(node))
+    return;
+
+  if(node->evicted) {
+      node->evicted = false;
+      stats.refaults++;
+  }
+
+  TreeCore::populate(node, [this](TreeNode *parent, const QString &key, const QJsonValue &val) {
+      return addChild(parent, key, val);
+  });
+  if(!node->pending.isEmpty()) {
+      for(auto child : node->children) {
+          auto found = node->pending.constFind(node->data.isObject() ? child->key : QString::number(child->pos));
+          if(found != node->pending.constEnd()) {
+              child->range = found.value();
+              child->unloaded = true;
+          }
+      }
+      node->pending.clear();
+  }
+  if(options & SubtreeStatistics)
+    for(auto child : node->children)
+      child->subtree = computeStats(child);
+
+  node->rawText.reset();
+
+  // Keep the order chosen with sort() for items expanded later.
+  if(sortColumn >= 0 && node->children.count() > 1) {
+      node->view = new ChildView;
+      node->view->column = sortColumn;
+      node->view->order = sortOrder;
+      updateView(node);
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::refault
+ *
+ * Read the value of an unloaded node from the file, the way the OnDemand
+ * load option reads the top-level value: one level deep, leaving the
+ * objects and arrays in it in the file as pending members. The ancestors
+ * take the value again. Values left in the file by the memory budget count
+ * as refaults; others are counted as read.
+ *
+ * A value below a node edited in the open transaction is not read, since
+ * a rollback would restore the placeholder of the ancestor.
+ *
+ * @param node: The node
+ * @return Returns false if the value is still only in the file: the file
+ * changed or cannot be read, or the transaction does not allow it.
+ */
+
+bool JsonTreeModel::refault(TreeNode *node)
+{
+  QFile file(rangeFile);
+  QJsonParseError err;
+
+
+  if(!node->unloaded)
+    return true;
+
+  for(TreeNode *n = node; n != nullptr && transactionOpen; n = n->parent)
+    if(originals.contains(n))
+      return false;
+
+  uchar *mapped = mapSource(&file, rangeSize, rangeTime, node->range);
+  if(mapped == nullptr)
+    return false;
+
+  JsonStreamReader reader(reinterpret_cast<const char *>(mapped), node->range.end - node->range.start);
+  reader.setShallow(true);
+  QJsonValue value = reader.read(&err);
+  file.unmap(mapped);
+
+  if(err.error != QJsonParseError::NoError) {
+      qWarning("%s: %s at offset %lld", qPrintable(rangeFile), qPrintable(err.errorString()), node->range.start + reader.offset());
+      return false;
+  }
+  if(value.type() != node->data.type()) {
+      qWarning("%s: the value at offset %lld changed", qPrintable(rangeFile), node->range.start);
+      return false;
+  }
+
+  if(node->evicted) {
+      node->evicted = false;
+      stats.refaults++;
+  }
+  else {
+      stats.logicalNodes += value.isObject() ? value.toObject().size() : value.toArray().size();
+  }
+
+  QHash<QString, SourceRange> skipped = reader.skipped();
+  for(auto it = skipped.constBegin(); it != skipped.constEnd(); ++it)
+    node->pending.insert(it.key(), SourceRange(node->range.start + it->start, node->range.start + it->end));
+
+  node->data = value;
+  node->rawText = reader.rawText();
+  node->unloaded = false;
+  node->lastUse = ++useClock;
+  writeUp(node, node->pos, node->key);
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::jsonFromVariant
+ *
+ * Create a QJsonValue object from a QVariant.
+ *
+ * This function performs some rudimamentary type checking as follows:
+ * @li If the whole variant string is an integer, create an integer.
+ * @li Else, if the whole string is a finite number in JSON syntax, create a double.
+ * @li If both conversions fail, then create a string.
+ *
+ * The text is converted with std::from_chars, without exceptions or
+ * allocations. Numbers that would not be saved as they were typed, such as
+ * 1.50 or integers too large for a double, keep their text in raw.
+ *
+ * @param var: The QVariant to convert
+ * @param raw: Receives the text to save for a number; empty if not needed
+ * @return Returns a QJsonValue of type double/integer/string
+ */
+
+QJsonValue JsonTreeModel::jsonFromVariant(const QVariant &var, QByteArray *raw)
+{
+  QString sVal = var.toString();
+  QByteArray text = sVal.toLatin1();
+  const char *first = text.constData();
+  const char *last = first + text.size();
+  long long iVal;
+  double dVal;
+
+
+  raw->clear();
+  // Not "inf", "nan", "01" or "1.": those stay strings. toLatin1() turns
+  // other characters into '?', which isNumber() rejects too.
+  if(!JsonStreamReader::isNumber(first, text.size()))
+    return QJsonValue(sVal);
+
+  std::from_chars_result result = std::from_chars(first, last, iVal);
+  if(result.ec == std::errc() && result.ptr == last) {
+      dVal = double(iVal);
+  }
+  else {
+      result = std::from_chars(first, last, dVal);
+      if(result.ec != std::errc() || result.ptr != last)
+        return QJsonValue(sVal);
+  }
+
+  if(!JsonStreamWriter::isCanonical(first, text.size(), dVal))
+    *raw = text;
+
+  return QJsonValue(dVal);
+}
+
+
+/**
+ * @brief JsonTreeModel::updateNode
+ *
+ * This function is called from setData(). It is the interface between the UI and the
+ * internal TreeNode model.
+ *
+ * Because Qt does everything by value, we have to update the TreeNode as follows:
+ * @li Update the values in the current TreeNode
+ * @li Get a QJsonObject or QJsonArray object from the node's parent
+ * @li For a QJsonObject, remove the old key/value pair and insert the new key/value pair.
+ * @li For a QJsonArray, replace the value at index i, which is the position of the node in its parent.
+ * @li Replace the parent node's @c data item with the new one.
+ * @li Walk @b up the tree so that the changes are propagated to the root of the document; see writeUp().
+ * @li Forget the text in the file of the node and its ancestors (TreeNode::range), which is stale now.
+ *
+ * @param node: The node being updated - starts at the node updated in the UI
+ * @param i: The index (TreeNode::pos) of the node being updated
+ * @param oldKey: Old key of the node being updated
+ * @param newKey: New key of the node being updated
+ * @param value: New value for the node
+ *
+ */
+
+void JsonTreeModel::updateNode(TreeNode *node, int i, const QString oldKey, const QString newKey, const QJsonValue value)
+{
+  if(node == nullptr)
+    return;
+
+
+  node->key = newKey;
+  node->data = value;
+  documentVersion++;
+  writeUp(node, i, oldKey);
+
+  // The text in the file no longer matches the values up to the root.
+  for(TreeNode *n = node; n != nullptr; n = n->parent)
+    n->range = SourceRange();
+
+  noteEdit(oldKey != newKey ? node->parent : node);
+
+}
+
+
+/**
+ * @brief JsonTreeModel::writeUp
+ *
+ * Store the value of node in its parent, and so on up to the root; each
+ * parent takes the new value of the child below it. The old values are not
+ * changed, so snapshots taken before keep them.
+ *
+ * @param node: The node whose @c data was changed
+ * @param i: Its index in the array value of the parent
+ * @param oldKey: Its key in the object value of the parent
+ */
+
+void JsonTreeModel::writeUp(TreeNode *node, int i, const QString &oldKey)
+{
+  QJsonObject jobj;
+  QJsonArray jarr;
+
+
+  for(TreeNode *child = node; child->parent != nullptr; child = child->parent) {
+      TreeNode *parent = child->parent;
+
+      switch(parent->data.type()) {
+
+        case QJsonValue::Type::Object:
+          jobj = parent->data.toObject();
+          jobj.remove(child == node ? oldKey : child->key);
+          jobj.insert(child->key, child->data);
+          parent->data = QJsonValue(jobj);
+          break;
+
+        case QJsonValue::Type::Array:
+          jarr = parent->data.toArray();
+          jarr[child == node ? i : child->pos] = child->data;
+          parent->data = QJsonValue(jarr);
+          break;
+
+        default:
+          qWarning("writeUp: the parent is not an object or array");
+          break;
+      }
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::propagate
+ *
+ * Push the current value of node into its parent, and so on up to the root.
+ * Used after the children of node were inserted, removed or moved.
+ *
+ * @param node: The container node whose @c data was changed
+ */
+
+void JsonTreeModel::propagate(TreeNode *node)
+{
+  updateNode(node, node->pos, node->key, node->key, node->data);
+}
+
+
+/**
+ * @brief JsonTreeModel::headerData
+ *
+ * Provide text for the two headers in the Qt tree view.
+ * @note the check for Qt::DisplayRole is required otherwise nothing is displayed.
+ *
+ * @param section: The column number
+ * @param orientation: Qt allows for horizontal or verticle headings
+ * @param role: Qt role.
+ *
+ * @return Returns a string (as a variant) to use for the column heading.
+ */
+
+QVariant JsonTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  Q_UNUSED(orientation);
+
+  // Check for DisplayRole is required for Qt to display the header at all.
+  if (role != Qt::DisplayRole)
+      return QVariant();
+
+  switch(section) {
+
+    case KeyColumn:
+      return QVariant(QString("Key"));
+
+    case NodesColumn:
+      return QVariant(QString("Nodes"));
+
+    case DepthColumn:
+      return QVariant(QString("Depth"));
+
+    case BytesColumn:
+      return QVariant(QString("Bytes"));
+
+    default:
+      return QVariant(QString("Value"));
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::index
+ *
+ * This function maps from the Qt abstract model row/column to the model's
+ * concept of row/column.
+ *
+ * The @c internalPointer item of QModelIndex stores a pointer to a TreeNode structure.
+ *
+ * @param row: The row index of the item under its parent item.
+ * @param column: The column index of the item
+ * @param parent: The index of the item's parent in the tree view.
+ * @return Returns a QModelIndex that locates the corresponding item in the UI;
+ * Returns an empty index if the @c row and @c column are out of bounds.
+ *
+ */
+
+QModelIndex JsonTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+  TreeNode *parentNode, *childNode;
+
+  // If the index is out of bounds, return an empty index.
+  if(hasIndex(row, column, parent) == false) {
+      return QModelIndex();
+  }
+
+  // If there is no parent, then Qt is asking us for the index of the root item.
+  if(parent.isValid() == false) {
+    parentNode = tree.root();
+  }
+  else {
+    parentNode = static_cast<TreeNode *>(parent.internalPointer());
+  }
+
+  if(parentNode->view != nullptr)
+    childNode = parentNode->view->rows[row];
+  else
+    childNode = parentNode->children[row];
+  return createIndex(row, column, childNode);
+}
+
+
+/**
+ * @brief JsonTreeModel::parent
+ *
+ * Similar to index(), this function receives a QModelIndex and returns
+ * an index for its parent.
+ *
+ * @param index: The index to find the parent of
+ * @return Returns a QModelIndex for the parent; Returns an empty index if the
+ * parent is the root item.
+ */
+
+QModelIndex JsonTreeModel::parent(const QModelIndex &index) const
+{
+
+  if(!index.isValid())
+    return QModelIndex();
+
+  TreeNode *childNode  = static_cast<TreeNode *>(index.internalPointer());
+  TreeNode *parentNode = childNode->parent;
+
+  if(parentNode == tree.root())
+    return QModelIndex();
+
+  return createIndex(parentNode->row(), 0, parentNode);
+}
+
+
+/**
+ * @brief JsonTreeModel::rowCount
+ *
+ * Returns the number of rows (children) under the parent index.
+ *
+ * @param parent: Index of the parent item
+ * @return Returns the number of children under the given parent.
+ */
+
+int JsonTreeModel::rowCount(const QModelIndex &parent) const
+{
+  TreeNode *parentNode;
+
+
+  if(parent.isValid() == false)
+      parentNode = tree.root();
+  else
+      parentNode = static_cast<TreeNode *>(parent.internalPointer());
+
+  if(parentNode == nullptr)
+    return 0;
+
+  if(parentNode->view != nullptr)
+    return parentNode->view->rows.count();
+
+  return parentNode->children.count();
+}
+
+
+/**
+ * @brief JsonTreeModel::columnCount
+ *
+ * Returns the number of columns under the parent index.
+ *
+ * @param parent: Index of the parent item
+ * @return Returns 2 columns, or 5 with the SubtreeStatistics load option, regardless of parent.
+ */
+
+int JsonTreeModel::columnCount(const QModelIndex &parent) const
+{
+  Q_UNUSED(parent)
+
+  // Two columns: Key, and Value; then the statistics columns if they were asked for.
+  if(options & SubtreeStatistics)
+    return BytesColumn + 1;
+
+  return 2;
+}
+
+
+/**
+ * @brief JsonTreeModel::hasChildren
+ *
+ * An unpopulated node always has children; they are created by fetchMore().
+ *
+ * @param parent: Index of the parent item
+ * @return Returns true if the parent has, or will have, children.
+ */
+
+bool JsonTreeModel::hasChildren(const QModelIndex &parent) const
+{
+  TreeNode *parentNode;
+
+
+  if(parent.isValid() == false)
+      parentNode = tree.root();
+  else
+      parentNode = static_cast<TreeNode *>(parent.internalPointer());
+
+  if(parentNode == nullptr)
+    return false;
+
+  if(parentNode->view != nullptr)
+    return !parentNode->view->rows.isEmpty();
+
+  return !parentNode->populated || !parentNode->children.isEmpty();
+}
+
+
+/**
+ * @brief JsonTreeModel::canFetchMore
+ *
+ * @param parent: Index of the parent item
+ * @return Returns true if the children of parent have not been built yet.
+ */
+
+bool JsonTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+  if(parent.isValid() == false)
+    return false;
+
+  return !static_cast<TreeNode *>(parent.internalPointer())->populated;
+}
+
+
+/**
+ * @brief JsonTreeModel::fetchMore
+ *
+ * Called by the view when an unpopulated item is expanded. Reads the value
+ * of an unloaded item from the file and builds the children of the item
+ * with populate(), then evicts collapsed subtrees if this exceeds the
+ * memory budget. If the value cannot be read, nothing is fetched.
+ *
+ * @param parent: Index of the parent item
+ */
+
+void JsonTreeModel::fetchMore(const QModelIndex &parent)
+{
+  if(canFetchMore(parent) == false)
+    return;
+
+  TreeNode *parentNode = static_cast<TreeNode *>(parent.internalPointer());
+  int count;
+
+  if(!refault(parentNode))
+    return;
+
+  if(parentNode->data.isObject())
+    count = parentNode->data.toObject().size();
+  else if(parentNode->data.isArray())
+    count = parentNode->data.toArray().size();
+  else
+    count = 0;
+
+  if(count == 0) {
+      parentNode->populated = true;
+      return;
+  }
+
+  // The view fetches the children of the item it expands.
+  for(TreeNode *n = parentNode; n != nullptr; n = n->parent)
+    n->expanded = true;
+  parentNode->lastUse = ++useClock;
+
+  beginInsertRows(parent, 0, count - 1);
+  populate(parentNode);
+  endInsertRows();
+  enforceBudget();
+}
+
+
+/**
+ * @brief JsonTreeModel::data
+ *
+ * Returns a variant holding the data at the given model index.
+ *
+ * @param index: The index for which to return data
+ * @param role: The Qt role; we return an empty variant for all but DisplayRole
+ * @return Returns a variant with the data to display at the given model index.
+ */
+
+QVariant JsonTreeModel::data(const QModelIndex &index, int role) const
+{
+
+  if(!index.isValid())
+    return QVariant();
+
+  // Use the index to retrieve the internal pointer
+  TreeNode *item = static_cast<TreeNode *>(index.internalPointer());
+
+  // Schema violations: a red mark before the key, and the messages as tool tip.
+  if(role == Qt::ToolTipRole || role == Qt::DecorationRole || role == ViolationsRole) {
+      if(violations.isEmpty() || (role == Qt::DecorationRole && index.column() != KeyColumn))
+        return QVariant();
+
+      QStringList messages = violationsOf(JsonPointer::fromTokens(pathOf(item)));
+      if(messages.isEmpty())
+        return QVariant();
+      if(role == Qt::DecorationRole)
+        return QColor(Qt::red);
+      if(role == Qt::ToolTipRole)
+        return messages.join('\n');
+      return messages;
+  }
+
+  if(role != Qt::DisplayRole)
+    return QVariant();
+
+  switch(index.column()) {
+
+    case NodesColumn:
+      return QVariant(item->subtree.nodes);
+
+    case DepthColumn:
+      return QVariant(item->subtree.depth);
+
+    case BytesColumn:
+      return QVariant(item->subtree.bytes);
+  }
+
+  // Column 1 is the data item, column 0 is the key
+  if(index.column() == 1) {
+      if(!item->raw.isEmpty())
+        return QVariant(QString::fromLatin1(item->raw));
+      return item->data.toVariant();
+  }
+  else {
+      if(item->key.isEmpty()) {
+        QString temp;
+        int depth = seekPath.indexOf(item);
+
+        // Items of a partial array show their index in the file.
+        temp = temp.sprintf("[%d]", depth > 0 ? seekTokens[depth - 1].toInt() : item->pos);
+        return QVariant(temp);
+      }
+      else
+        return QVariant(item->key);
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::setData
+ *
+ * Called by Qt when the user edits an item in the tree view. Either the
+ * key (column 0) or the value (column 1) has been changed.
+ *
+ * The updateNode() function is called to set the new value and to propagate the
+ * changes up to the root of the document tree.
+ *
+ * Emits the dataChanged signal once the new value is set.
+ * Inside a transaction (see beginTransaction()) both the propagation and the
+ * signal are deferred to commitTransaction().
+ *
+ * @param index: The model index of the item that was edited.
+ * @param value: The new value provided by the user via the UI.
+ * @param role: The Qt role (not used in this function)
+ * @return Returns true if the change was made; false otherwise.
+ */
+
+bool JsonTreeModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+
+  // The statistics columns are computed.
+  if(index.column() > ValueColumn)
+    return false;
+
+  if(!(flags(index) & Qt::ItemIsEditable))
+    return false;
+
+  if(data(index, role) != value) {
+
+      // Need to get the parent (object or array) and set the key/value
+      // To update only the key, need to first remove the key, then add new key/value.
+      TreeNode *item = static_cast<TreeNode *>(index.internalPointer());
+      if(!refault(item))
+        return false;
+
+      QString newKey = item->key;
+      QJsonValue newValue = item->data;
+      QByteArray newRaw = item->raw;
+      QJsonArray record{index.column() == 0 ? "key" : "value", QJsonArray::fromStringList(pathOf(item)),
+                        QJsonValue::fromVariant(value)};
+
+      if(index.column() == 0) {
+
+          // An empty key means the tree item corresponds to an item in a JsonArray.
+          // Edits are disallowed, since it's not really a key.
+          if(value.toString().isEmpty() == true)
+            return false;
+
+          newKey = value.toString();
+      }
+      else {
+          if(index.column() == 1)
+            newValue = jsonFromVariant(value, &newRaw);
+      }
+
+      modified = true;
+
+      // Inside a transaction only the node itself changes; its ancestors
+      // and the view are updated by commitTransaction().
+      if(transactionOpen) {
+          auto orig = originals.find(item);
+          if(orig == originals.end())
+            orig = originals.insert(item, Original{item->key, item->data, item->raw, 0});
+          orig->columns |= 1 << index.column();
+          item->key = newKey;
+          item->data = newValue;
+          item->raw = newRaw;
+          journal->append(record);
+          return true;
+      }
+
+      item->raw = newRaw;
+      journal->append(record);
+      updateNode(item, item->pos, item->key, newKey, newValue);
+      updateStats(item);
+      syncColumns(item);
+      emit dataChanged(index, index, QVector<int>() << role);
+      emitStatsChanged(QList<TreeNode *>() << item);
+      refreshViews(QList<TreeNode *>() << item);
+      return true;
+  }
+
+  return false;
+}
+
+
+/**
+ * @brief JsonTreeModel::beginTransaction
+ *
+ * Start collecting edits. Until the transaction is committed or rolled back,
+ * setData() only changes the edited nodes: no values are propagated to the
+ * root and no dataChanged signals are emitted. Structural edits are refused.
+ *
+ * @return Returns false if a transaction is already open.
+ */
+
+bool JsonTreeModel::beginTransaction()
+{
+  if(transactionOpen)
+    return false;
+
+  transactionOpen = true;
+  modifiedBeforeTransaction = modified;
+  journal->append(QJsonArray{"begin"});
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::commitTransaction
+ *
+ * Apply the edits of the open transaction to the rest of the tree.
+ *
+ * The edited nodes are grouped by parent, and parents are processed from the
+ * deepest level up. Each touched container applies the changes of its edited
+ * children to its value once, and then becomes a changed child of its own
+ * parent, so every touched ancestor is rebuilt exactly once.
+ *
+ * The view is then told about the edits with one dataChanged signal per
+ * contiguous range of edited rows.
+ *
+ * @return Returns false if no transaction is open.
+ */
+
+bool JsonTreeModel::commitTransaction()
+{
+  QMap<int, QHash<TreeNode *, QList<TreeNode *>>> levels;
+
+
+  if(!transactionOpen)
+    return false;
+
+  for(auto it = originals.constBegin(); it != originals.constEnd(); ++it) {
+      TreeNode *node = it.key();
+      if(node->parent == nullptr)
+        continue;
+
+      int depth = 0;
+      for(TreeNode *p = node->parent; p->parent != nullptr; p = p->parent)
+        depth++;
+      levels[depth][node->parent].append(node);
+  }
+
+  while(!levels.isEmpty()) {
+      auto deepest = levels.end();
+      --deepest;
+      int depth = deepest.key();
+      QHash<TreeNode *, QList<TreeNode *>> parents = deepest.value();
+      levels.erase(deepest);
+
+      for(auto it = parents.constBegin(); it != parents.constEnd(); ++it) {
+          TreeNode *node = it.key();
+          applyChanges(node, it.value());
+
+          // An edited node is already listed under its parent.
+          if(node->parent != nullptr && !originals.contains(node))
+            levels[depth - 1][node->parent].append(node);
+      }
+  }
+
+  for(auto it = originals.constBegin(); it != originals.constEnd(); ++it) {
+      updateStats(it.key());
+      syncColumns(it.key());
+      noteEdit(it.value().key != it.key()->key ? it.key()->parent : it.key());
+  }
+
+  emitChanged();
+  emitStatsChanged(originals.keys());
+  transactionOpen = false;
+  journal->append(QJsonArray{"commit"});
+  refreshViews(originals.keys());
+  originals.clear();
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::rollbackTransaction
+ *
+ * Discard the edits of the open transaction. Since nothing was propagated,
+ * restoring the edited nodes is enough to restore the document.
+ */
+
+void JsonTreeModel::rollbackTransaction()
+{
+  if(!transactionOpen)
+    return;
+
+  for(auto it = originals.constBegin(); it != originals.constEnd(); ++it) {
+      it.key()->key = it->key;
+      it.key()->data = it->data;
+      it.key()->raw = it->raw;
+  }
+
+  emitChanged();
+  modified = modifiedBeforeTransaction;
+  transactionOpen = false;
+  journal->append(QJsonArray{"rollback"});
+  refreshViews(originals.keys());
+  originals.clear();
+}
+
+
+/**
+ * @brief JsonTreeModel::inTransaction
+ * @return Returns true between beginTransaction() and commitTransaction()/rollbackTransaction().
+ */
+
+bool JsonTreeModel::inTransaction() const
+{
+  return transactionOpen;
+}
+
+
+/**
+ * @brief JsonTreeModel::applyChanges
+ *
+ * Used by commitTransaction(): write the current key/value of the changed
+ * children into the value of node.
+ *
+ * Object members are removed under the key they had before the transaction
+ * before any is re-inserted, so that keys swapped between members survive.
+ *
+ * @param node: The container whose children changed
+ * @param changed: The changed children of node
+ */
+
+void JsonTreeModel::applyChanges(TreeNode *node, const QList<TreeNode *> &changed)
+{
+  documentVersion++;
+  if(node->data.isObject()) {
+      QJsonObject jobj = node->data.toObject();
+      for(auto child : changed)
+        jobj.remove(originals.contains(child) ? originals[child].key : child->key);
+      for(auto child : changed)
+        jobj.insert(child->key, child->data);
+      node->data = jobj;
+  }
+  else if(node->data.isArray()) {
+      QJsonArray jarr = node->data.toArray();
+      for(auto child : changed)
+        jarr[child->pos] = child->data;
+      node->data = jarr;
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::emitChanged
+ *
+ * Emit dataChanged for the nodes edited in the open transaction, with one
+ * signal per run of consecutive rows under the same parent.
+ */
+
+void JsonTreeModel::emitChanged()
+{
+  QHash<TreeNode *, QMap<int, int>> rowsByParent;
+
+
+  for(auto it = originals.constBegin(); it != originals.constEnd(); ++it) {
+      if(it.key()->parent != nullptr && it.key()->row() >= 0)
+        rowsByParent[it.key()->parent][it.key()->row()] |= it->columns;
+  }
+
+  for(auto it = rowsByParent.constBegin(); it != rowsByParent.constEnd(); ++it) {
+      QModelIndex parentIndex = indexFromNode(it.key());
+      const QMap<int, int> &rows = it.value();
+
+      auto run = rows.constBegin();
+      while(run != rows.constEnd()) {
+          int first = run.key(), last = first, columns = run.value();
+          for(++run; run != rows.constEnd() && run.key() == last + 1; ++run) {
+              last = run.key();
+              columns |= run.value();
+          }
+
+          int firstColumn = (columns & 1) ? 0 : 1;
+          int lastColumn = (columns & 2) ? 1 : 0;
+          emit dataChanged(index(first, firstColumn, parentIndex), index(last, lastColumn, parentIndex),
+                           QVector<int>() << Qt::DisplayRole << Qt::EditRole);
+      }
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::nodeFromIndex
+ *
+ * @param index: A model index, or an invalid index for the root
+ * @return Returns the TreeNode of the index; the root node for an invalid index.
+ */
+
+TreeNode *JsonTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+  if(index.isValid() == false)
+    return tree.root();
+
+  return static_cast<TreeNode *>(index.internalPointer());
+}
+
+
+/**
+ * @brief JsonTreeModel::indexFromNode
+ *
+ * @param node: A TreeNode of this model
+ * @param column: Column of the index
+ * @return Returns the model index of node; an invalid index for the root.
+ */
+
+QModelIndex JsonTreeModel::indexFromNode(TreeNode *node, int column) const
+{
+  if(node == nullptr || node == tree.root())
+    return QModelIndex();
+
+  return createIndex(node->row(), column, node);
+}
+
+
+/**
+ * @brief JsonTreeModel::uniqueKey
+ *
+ * Find a key, starting with base, that is not yet used in jobj.
+ * Used for members inserted into, or moved into, an object.
+ *
+ * @param jobj: The object the key is for
+ * @param base: The preferred key
+ * @return Returns base, or base followed by the smallest number that makes it unique.
+ */
+
+QString JsonTreeModel::uniqueKey(const QJsonObject &jobj, const QString &base) const
+{
+  QString key = base;
+
+
+  for(int n = 1; jobj.contains(key); n++)
+    key = base + QString::number(n);
+
+  return key;
+}
+
+
+/**
+ * @brief JsonTreeModel::insertRows
+ *
+ * Insert count null items before the given row of an object or array.
+ * Object members are given unique keys of the form "key", "key1", ...
+ *
+ * Only the parent container is rebuilt (and its ancestors, as in setData()),
+ * so the cost is proportional to the number of rows in the parent.
+ *
+ * @note QJsonObject keeps its members sorted by key, and so does the saved
+ * file. A new object member is therefore inserted at the row where its key
+ * sorts, not at @p row, so that the tree shows the order the document will
+ * have; each one is inserted on its own, since the rows need not be adjacent.
+ * Structural edits are refused while a transaction is open, and for
+ * containers that are sorted or filtered (see restoreOrder()).
+ *
+ * @param row: Row before which the new items are inserted; ignored for objects
+ * @param count: Number of items to insert
+ * @param parent: Index of the object or array
+ * @return Returns true if the items were inserted.
+ */
+
+bool JsonTreeModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+  TreeNode *parentNode = nodeFromIndex(parent);
+
+
+  if(parentNode == nullptr || count <= 0 || transactionOpen || parentNode->view != nullptr)
+    return false;
+
+  if(onSeekPath(parentNode) && parentNode != seekPath.last())
+    return false;
+
+  if(!parentNode->data.isObject() && !parentNode->data.isArray())
+    return false;
+
+  if(canFetchMore(parent))
+    fetchMore(parent);
+
+  if(row < 0 || row > parentNode->children.count())
+    return false;
+
+  journal->append(QJsonArray{"insert", QJsonArray::fromStringList(pathOf(parentNode)), row, count});
+
+  if(parentNode->data.isObject()) {
+      QJsonObject jobj = parentNode->data.toObject();
+      QStringList keys;
+
+      for(int i = 0; i < count; i++) {
+          keys.append(uniqueKey(jobj, QString("key")));
+          jobj.insert(keys.last(), QJsonValue());
+      }
+      std::sort(keys.begin(), keys.end());
+
+      for(const QString &key : keys) {
+          int at = 0;
+          for(auto child : parentNode->children)
+            if(child->key < key)
+              at++;
+
+          beginInsertRows(parent, at, at);
+          jobj = parentNode->data.toObject();
+          jobj.insert(key, QJsonValue());
+          parentNode->data = jobj;
+          TreeNode *newNode = addChild(parentNode, key, QJsonValue(), at);
+          propagate(parentNode);
+          updateStats(newNode);
+          updateStats(parentNode);
+          modified = true;
+          endInsertRows();
+      }
+  }
+  else {
+      QJsonArray jarr = parentNode->data.toArray();
+
+      beginInsertRows(parent, row, row + count - 1);
+      for(int i = 0; i < count; i++) {
+          jarr.insert(row + i, QJsonValue());
+          addChild(parentNode, QString(""), QJsonValue(), row + i);
+      }
+      parentNode->data = jarr;
+      propagate(parentNode);
+      for(int i = row; i < row + count; i++)
+        updateStats(parentNode->children[i]);
+      updateStats(parentNode);
+      modified = true;
+      endInsertRows();
+  }
+  syncColumns(parentNode);
+
+  // Array items after the insertion point show a new [n] label.
+  int last = parentNode->children.count() - 1;
+  if(parentNode->data.isArray() && row + count <= last)
+    emit dataChanged(index(row + count, 0, parent), index(last, 0, parent), QVector<int>() << Qt::DisplayRole);
+
+  emitStatsChanged(QList<TreeNode *>() << parentNode);
+  refreshViews(QList<TreeNode *>() << parentNode);
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::removeRows
+ *
+ * Remove count items, starting at the given row, from an object or array.
+ * The TreeNodes of the removed subtrees are freed.
+ *
+ * @param row: First row to remove
+ * @param count: Number of items to remove
+ * @param parent: Index of the object or array
+ * @return Returns true if the items were removed.
+ */
+
+bool JsonTreeModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+  TreeNode *parentNode = nodeFromIndex(parent);
+
+
+  if(parentNode == nullptr || count <= 0 || transactionOpen || parentNode->view != nullptr)
+    return false;
+
+  if(onSeekPath(parentNode) && parentNode != seekPath.last())
+    return false;
+
+  if(row < 0 || row + count > parentNode->children.count())
+    return false;
+
+  journal->append(QJsonArray{"remove", QJsonArray::fromStringList(pathOf(parentNode)), row, count});
+  beginRemoveRows(parent, row, row + count - 1);
+
+  if(parentNode->data.isObject()) {
+      QJsonObject jobj = parentNode->data.toObject();
+      for(int i = row; i < row + count; i++)
+        jobj.remove(parentNode->children[i]->key);
+      parentNode->data = jobj;
+  }
+  else {
+      QJsonArray jarr = parentNode->data.toArray();
+      for(int i = 0; i < count; i++)
+        jarr.removeAt(row);
+      parentNode->data = jarr;
+  }
+
+  for(int i = 0; i < count; i++)
+    freeTraverse(parentNode->children.takeAt(row));
+  parentNode->renumber(row);
+
+  propagate(parentNode);
+  updateStats(parentNode);
+  modified = true;
+  endRemoveRows();
+  syncColumns(parentNode);
+
+  // Array items after the removed rows show a new [n] label.
+  int last = parentNode->children.count() - 1;
+  if(parentNode->data.isArray() && row <= last)
+    emit dataChanged(index(row, 0, parent), index(last, 0, parent), QVector<int>() << Qt::DisplayRole);
+
+  emitStatsChanged(QList<TreeNode *>() << parentNode);
+  refreshViews(QList<TreeNode *>() << parentNode);
+  return true;
+}
+
+
+/**
+ * @brief JsonTreeModel::moveRows
+ *
+ * Move count items from one object or array to another, or within the same
+ * container. Items moved into an object keep their key if it is free and are
+ * given a unique key otherwise; items moved into an array lose their key.
+ *
+ * The members of an object are ordered by key, as in QJsonObject, so items
+ * moved into an object are placed one by one at the row where their key sorts,
+ * and destinationChild is ignored. Moving members within an object is refused,
+ * as is moving an item into its own subtree.
+ *
+ * @param sourceParent: Index of the container the items are moved from
+ * @param sourceRow: First row to move
+ * @param count: Number of items to move
+ * @param destinationParent: Index of the container the items are moved to
+ * @param destinationChild: Row, before the move, in front of which the items are placed
+ * @return Returns true if the items were moved.
+ */
+
+bool JsonTreeModel::moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                             const QModelIndex &destinationParent, int destinationChild)
+{
+  TreeNode *srcNode = nodeFromIndex(sourceParent);
+  TreeNode *dstNode = nodeFromIndex(destinationParent);
+  QList<TreeNode *> moved;
+  QJsonObject jobj;
+  QJsonArray jarr;
+
+
+  if(srcNode == nullptr || dstNode == nullptr || count <= 0 || transactionOpen)
+    return false;
+
+  if((onSeekPath(srcNode) && srcNode != seekPath.last()) || (onSeekPath(dstNode) && dstNode != seekPath.last()))
+    return false;
+
+  if(srcNode->view != nullptr || dstNode->view != nullptr)
+    return false;
+
+  if(!dstNode->data.isObject() && !dstNode->data.isArray())
+    return false;
+
+  if(canFetchMore(destinationParent))
+    fetchMore(destinationParent);
+
+  if(sourceRow < 0 || sourceRow + count > srcNode->children.count())
+    return false;
+
+  if(destinationChild < 0 || destinationChild > dstNode->children.count())
+    return false;
+
+  if(dstNode->data.isObject() && srcNode == dstNode)
+    return false;
+
+  for(TreeNode *n = dstNode; n != nullptr; n = n->parent)
+    if(n->parent == srcNode && n->pos >= sourceRow && n->pos < sourceRow + count)
+      return false;
+
+  QJsonArray record{"move", QJsonArray::fromStringList(pathOf(srcNode)), sourceRow, count,
+                    QJsonArray::fromStringList(pathOf(dstNode)), destinationChild};
+
+  if(dstNode->data.isObject()) {
+      journal->append(record);
+      for(int i = 0; i < count; i++) {
+          TreeNode *node = srcNode->children[sourceRow];
+          QString key = uniqueKey(dstNode->data.toObject(), node->key.isEmpty() ? QString("key") : node->key);
+          int at = 0;
+          for(auto child : dstNode->children)
+            if(child->key < key)
+              at++;
+
+          beginMoveRows(sourceParent, sourceRow, sourceRow, destinationParent, at);
+          srcNode->children.removeAt(sourceRow);
+          srcNode->renumber(sourceRow);
+          if(srcNode->data.isObject()) {
+              jobj = srcNode->data.toObject();
+              jobj.remove(node->key);
+              srcNode->data = jobj;
+          }
+          else {
+              jarr = srcNode->data.toArray();
+              jarr.removeAt(sourceRow);
+              srcNode->data = jarr;
+          }
+
+          jobj = dstNode->data.toObject();
+          jobj.insert(key, node->data);
+          dstNode->data = jobj;
+          node->key = key;
+          node->parent = dstNode;
+          dstNode->children.insert(at, node);
+          dstNode->renumber(at);
+
+          propagate(srcNode);
+          propagate(dstNode);
+          node->subtree = computeStats(node);
+          updateStats(srcNode);
+          updateStats(dstNode);
+          modified = true;
+          endMoveRows();
+      }
+
+      syncColumns(srcNode);
+      if(srcNode->data.isArray() && sourceRow < srcNode->children.count())
+        emit dataChanged(index(sourceRow, 0, sourceParent), index(srcNode->children.count() - 1, 0, sourceParent), QVector<int>() << Qt::DisplayRole);
+      emit dataChanged(index(0, 0, destinationParent), index(dstNode->children.count() - 1, 0, destinationParent), QVector<int>() << Qt::DisplayRole);
+
+      emitStatsChanged(QList<TreeNode *>() << srcNode << dstNode);
+      refreshViews(QList<TreeNode *>() << srcNode << dstNode);
+      return true;
+  }
+
+  if(beginMoveRows(sourceParent, sourceRow, sourceRow + count - 1, destinationParent, destinationChild) == false)
+    return false;
+
+  journal->append(record);
+
+  // Take the items out of the source container.
+  for(int i = 0; i < count; i++)
+    moved.append(srcNode->children.takeAt(sourceRow));
+
+  if(srcNode->data.isObject()) {
+      jobj = srcNode->data.toObject();
+      for(auto node : moved)
+        jobj.remove(node->key);
+      srcNode->data = jobj;
+  }
+  else {
+      jarr = srcNode->data.toArray();
+      for(int i = 0; i < count; i++)
+        jarr.removeAt(sourceRow);
+      srcNode->data = jarr;
+  }
+
+  if(srcNode == dstNode && destinationChild > sourceRow)
+    destinationChild -= count;
+
+  // Put them into the destination array.
+  jarr = dstNode->data.toArray();
+  for(int i = 0; i < count; i++) {
+      moved[i]->key = QString("");
+      jarr.insert(destinationChild + i, moved[i]->data);
+  }
+  dstNode->data = jarr;
+
+  for(int i = 0; i < count; i++) {
+      moved[i]->parent = dstNode;
+      dstNode->children.insert(destinationChild + i, moved[i]);
+  }
+
+  int first = (srcNode == dstNode) ? qMin(sourceRow, destinationChild) : sourceRow;
+  srcNode->renumber(first);
+  if(dstNode != srcNode)
+    dstNode->renumber(destinationChild);
+
+  propagate(srcNode);
+  if(dstNode != srcNode)
+    propagate(dstNode);
+
+  // The moved items may have gained or lost their key prefix.
+  if(dstNode != srcNode) {
+      for(auto node : moved)
+        node->subtree = computeStats(node);
+      updateStats(srcNode);
+      updateStats(dstNode);
+  }
+
+  modified = true;
+  endMoveRows();
+
+  syncColumns(srcNode);
+  if(dstNode != srcNode)
+    syncColumns(dstNode);
+
+  // Array items from the first moved position on show a new [n] label,
+  // and items moved to another container may have a new key.
+  if(srcNode->data.isArray() && first < srcNode->children.count())
+    emit dataChanged(index(first, 0, sourceParent), index(srcNode->children.count() - 1, 0, sourceParent), QVector<int>() << Qt::DisplayRole);
+  if(dstNode != srcNode)
+    emit dataChanged(index(destinationChild, 0, destinationParent), index(dstNode->children.count() - 1, 0, destinationParent), QVector<int>() << Qt::DisplayRole);
+
+  emitStatsChanged(QList<TreeNode *>() << srcNode << dstNode);
+  refreshViews(QList<TreeNode *>() << srcNode << dstNode);
+  return true;
+}
+
+
+/**
+ * @brief ParallelThreshold
+ *
+ * Number of children from which sort keys are computed, and children are
+ * sorted, on all cores.
+ */
+
+static const int ParallelThreshold = 16384;
+
+
+/**
+ * @brief RepositionLimit
+ *
+ * Number of edited children of a sorted container up to which the children
+ * are moved one by one; above it, the container is sorted again.
+ */
+
+static const int RepositionLimit = 64;
+
+
+/**
+ * @brief splitRange
+ *
+ * Split the rows [0, n) into one range per core.
+ */
+
+static QVector<QPair<int, int>> splitRange(int n)
+{
+  QVector<QPair<int, int>> ranges;
+  int parts = qMax(1, QThread::idealThreadCount());
+  int step = qMax(1, (n + parts - 1) / parts);
+
+
+  for(int first = 0; first < n; first += step)
+    ranges.append(qMakePair(first, qMin(first + step, n)));
+
+  return ranges;
+}
+
+
+/**
+ * @brief compareKeys
+ *
+ * @return Returns a negative number, zero or a positive number if a sorts
+ * before, together with or after b.
+ */
+
+static int compareKeys(const SortKey &a, const SortKey &b)
+{
+  if(a.rank != b.rank)
+    return a.rank < b.rank ? -1 : 1;
+
+  if(a.number != b.number)
+    return a.number < b.number ? -1 : 1;
+
+  return a.text.compare(b.text);
+}
+
+
+/**
+ * @brief The ViewOrder struct
+ *
+ * Ordering of the children of a node in its ChildView, using the cached sort keys.
+ * Children with equal keys, and all children of a view that is only filtered,
+ * keep their document order.
+ */
+
+struct ViewOrder {
+
+  const ChildView *view;
+
+  bool operator()(const TreeNode *a, const TreeNode *b) const {
+
+    if(view->column >= 0) {
+      int cmp = compareKeys(view->keys[a->pos], view->keys[b->pos]);
+      if(cmp != 0)
+        return view->order == Qt::AscendingOrder ? cmp < 0 : cmp > 0;
+    }
+
+    return a->pos < b->pos;
+  }
+};
+
+
+/**
+ * @brief The MergeSpan struct
+ *
+ * Two neighbouring sorted ranges [first, middle) and [middle, last) to merge.
+ */
+
+struct MergeSpan {
+  int first;
+  int middle;
+  int last;
+};
+
+
+/**
+ * @brief parallelSort
+ *
+ * Sort rows on all cores: each core sorts one range, then neighbouring ranges
+ * are merged pairwise, in parallel, until one range is left.
+ *
+ * @param rows: The rows to sort
+ * @param lessThan: The ordering
+ */
+
+static void parallelSort(QVector<TreeNode *> &rows, const ViewOrder &lessThan)
+{
+  if(rows.count() < ParallelThreshold) {
+    std::sort(rows.begin(), rows.end(), lessThan);
+    return;
+  }
+
+  TreeNode **base = rows.data();
+  QVector<QPair<int, int>> ranges = splitRange(rows.count());
+
+  QtConcurrent::blockingMap(ranges, [base, lessThan](const QPair<int, int> &range) {
+      std::sort(base + range.first, base + range.second, lessThan);
+  });
+
+  while(ranges.count() > 1) {
+      QVector<MergeSpan> spans;
+      QVector<QPair<int, int>> merged;
+
+      for(int i = 0; i + 1 < ranges.count(); i += 2) {
+          spans.append(MergeSpan{ranges[i].first, ranges[i].second, ranges[i + 1].second});
+          merged.append(qMakePair(ranges[i].first, ranges[i + 1].second));
+      }
+      if(ranges.count() % 2)
+        merged.append(ranges.last());
+
+      QtConcurrent::blockingMap(spans, [base, lessThan](const MergeSpan &span) {
+          std::inplace_merge(base + span.first, base + span.middle, base + span.last, lessThan);
+      });
+      ranges = merged;
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::sortKey
+ *
+ * Compute the key node is sorted by in the given view: its key for column 0,
+ * its subtree statistic for the statistics columns, otherwise its value, or
+ * the value of the view's child field.
+ * Objects and arrays all sort alike, after the scalar values; elements
+ * without the child field sort last.
+ *
+ * @param node: A child of the node the view belongs to
+ * @param view: The view
+ * @return Returns the sort key.
+ */
+
+SortKey JsonTreeModel::sortKey(TreeNode *node, const ChildView *view) const
+{
+  QJsonValue val = node->data;
+
+
+  if(view->column == 0) {
+      if(node->key.isEmpty())
+        return SortKey{2, double(node->pos), QString()};
+      return SortKey{3, 0, node->key};
+  }
+
+  switch(view->column) {
+
+    case NodesColumn:
+      return SortKey{2, double(node->subtree.nodes), QString()};
+
+    case DepthColumn:
+      return SortKey{2, double(node->subtree.depth), QString()};
+
+    case BytesColumn:
+      return SortKey{2, double(node->subtree.bytes), QString()};
+  }
+
+  if(!view->field.isEmpty()) {
+      if(!val.toObject().contains(view->field))
+        return SortKey{5, 0, QString()};
+      val = val.toObject().value(view->field);
+  }
+
+  switch(val.type()) {
+
+    case QJsonValue::Type::Null:
+      return SortKey{0, 0, QString()};
+
+    case QJsonValue::Type::Bool:
+      return SortKey{1, val.toBool() ? 1.0 : 0.0, QString()};
+
+    case QJsonValue::Type::Double:
+      return SortKey{2, val.toDouble(), QString()};
+
+    case QJsonValue::Type::String:
+      return SortKey{3, 0, val.toString()};
+
+    default:
+      return SortKey{4, 0, QString()};
+  }
+}
+
+
+/**
+ * @brief JsonTreeModel::filterText
+ *
+ * @param node: A child of the node the view belongs to
+ * @param view: The view
+ * @return Returns the text the filter of the view is matched against: the key
+ * (or [n] label) for column 0, otherwise the scalar value or child field value.
+ */
+
+QString JsonTreeModel::filterText(TreeNode *node, const ChildView *view) const
+{
+  QJsonValue val = node->data;
+
+
+  if(view->filterColumn == 0)
+    return node->key.isEmpty() ? QString("[%1]").arg(node->pos) : node->key;
+
+  if(view->filterColumn > ValueColumn)
+    return data(createIndex(0, view->filterColumn, node)).toString();
+
+  if(!view->field.isEmpty())
+    val = val.toObject().value(view->field);
+
+  if(val.isObject() || val.isArray())
+    return QString();
+
+  return val.toVariant().toString();
+}
+
+
+/**
+ * @brief JsonTreeModel::updateView
+ *
+ * Rebuild the ChildView of node from scratch: compute the sort key and the
+ * filter result of every child, then sort the accepted children.
+ * Both steps run on all cores for large containers.
+ *
+ * Callers are responsible for the layout change signals.
+ *
+ * @param node: A node with a ChildView
+ */
+
+void JsonTreeModel::updateView(TreeNode *node)
+{
+  ChildView *view = node->view;
+  int count = node->children.count();
+  QVector<char> accepted(count);
+  SortKey *keys;
+  char *acc = accepted.data();
+
+
+  if(view->column >= 0)
+    view->keys.resize(count);
+  else
+    view->keys.clear();
+  keys = view->keys.data();
+
+  auto compute = [this, node, view, keys, acc](const QPair<int, int> &range) {
+      for(int i = range.first; i < range.second; i++) {
+          TreeNode *child = node->children.at(i);
+          if(view->column >= 0)
+            keys[i] = sortKey(child, view);
+          acc[i] = view->filter.isEmpty() || filterText(child, view).contains(view->filter, Qt::CaseInsensitive);
+      }
+  };
+
+  if(count < ParallelThreshold) {
+      compute(qMakePair(0, count));
+  }
+  else {
+      QVector<QPair<int, int>> ranges = splitRange(count);
+      QtConcurrent::blockingMap(ranges, compute);
+  }
+
+  view->rows.clear();
+  view->rows.reserve(count);
+  for(int i = 0; i < count; i++) {
+      TreeNode *child = node->children.at(i);
+      child->vpos = -1;
+      if(acc[i])
+        view->rows.append(child);
+  }
+
+  parallelSort(view->rows, ViewOrder{view});
+
+  for(int i = 0; i < view->rows.count(); i++)
+    view->rows[i]->vpos = i;
+}
+
+
+/**
+ * @brief JsonTreeModel::reposition
+ *
+ * Incremental update of a ChildView after one child was edited: the child's
+ * sort key is recomputed and the child is moved to its new row with a binary
+ * search, or removed from/inserted into the view if it no longer/now passes
+ * the filter.
+ *
+ * @param node: The node the view belongs to
+ * @param child: The edited child
+ */
+
+void JsonTreeModel::reposition(TreeNode *node, TreeNode *child)
+{
+  ChildView *view = node->view;
+  QVector<TreeNode *> &rows = view->rows;
+  ViewOrder lessThan{view};
+  int from = child->vpos;
+  int to;
+
+
+  // Nothing of a hidden node is shown, so no signals are needed.
+  if(node != tree.root() && node->row() < 0) {
+      updateView(node);
+      return;
+  }
+
+  QModelIndex parentIndex = indexFromNode(node);
+
+  if(view->column >= 0)
+    view->keys[child->pos] = sortKey(child, view);
+  bool show = view->filter.isEmpty() || filterText(child, view).contains(view->filter, Qt::CaseInsensitive);
+
+  if(from >= 0 && !show) {
+      beginRemoveRows(parentIndex, from, from);
+      rows.remove(from);
+      child->vpos = -1;
+      for(int i = from; i < rows.count(); i++)
+        rows[i]->vpos = i;
+      endRemoveRows();
+  }
+  else if(from < 0 && show) {
+      to = std::upper_bound(rows.begin(), rows.end(), child, lessThan) - rows.begin();
+      beginInsertRows(parentIndex, to, to);
+      rows.insert(to, child);
+      for(int i = to; i < rows.count(); i++)
+        rows[i]->vpos = i;
+      endInsertRows();
+  }
+  else if(from >= 0) {
+      // The other rows are still sorted; search on the side the child moves to.
+      if(from > 0 && lessThan(child, rows[from - 1]))
+        to = std::upper_bound(rows.begin(), rows.begin() + from, child, lessThan) - rows.begin();
+      else
+        to = std::upper_bound(rows.begin() + from + 1, rows.end(), child, lessThan) - rows.begin() - 1;
+
+      if(to == from)
+        return;
+
+      beginMoveRows(parentIndex, from, from, parentIndex, to > from ? to + 1 : to);
+      rows.remove(from);
+      rows.insert(to, child);
+      for(int i = qMin(from, to); i <= qMax(from, to); i++)
+        rows[i]->vpos = i;
+      endMoveRows();
+  }
 }
 
 
 /**
- * @brief JsonTreeModel::toJsonDocument
- * @return Returns a QJsonDocument that is constructed from the current
- * tree structure.
+ * @brief JsonTreeModel::refreshViews
+ *
+ * Bring the views that show the edited nodes up to date: the view of each
+ * node's parent, a view of its grandparent that sorts or filters by a
+ * child field, and the views of its ancestors that sort by a statistics
+ * column. A few edits are repositioned one by one; a view with many
+ * edited rows is rebuilt, with one layoutChanged for all rebuilt views.
+ *
+ * @param edited: The edited nodes
  */
 
-QJsonDocument JsonTreeModel::toJsonDocument()
+void JsonTreeModel::refreshViews(const QList<TreeNode *> &edited)
 {
-  if(root->data.type() == QJsonValue::Array)
-    return QJsonDocument(root->data.toArray());
-  else
-    return QJsonDocument(root->data.toObject());
+  QHash<TreeNode *, QList<TreeNode *>> stale;
+  QList<TreeNode *> rebuild;
+
+
+  for(auto node : edited) {
+      TreeNode *parentNode = node->parent;
+      if(parentNode == nullptr)
+        continue;
+
+      if(parentNode->view != nullptr)
+        stale[parentNode].append(node);
+
+      TreeNode *grandParent = parentNode->parent;
+      if(grandParent != nullptr && grandParent->view != nullptr && !grandParent->view->field.isEmpty())
+        stale[grandParent].append(parentNode);
+
+      // The statistics of every ancestor changed with the node.
+      for(TreeNode *n = parentNode; n->parent != nullptr; n = n->parent) {
+          ChildView *view = n->parent->view;
+          if(view != nullptr && view->column > ValueColumn && !stale[n->parent].contains(n))
+            stale[n->parent].append(n);
+      }
+  }
+
+  for(auto it = stale.constBegin(); it != stale.constEnd(); ++it) {
+      if(it.value().count() > RepositionLimit)
+        rebuild.append(it.key());
+      else
+        for(auto child : it.value())
+          reposition(it.key(), child);
+  }
+
+  if(!rebuild.isEmpty()) {
+      QModelIndexList before = beginLayoutChange();
+      for(auto node : rebuild)
+        updateView(node);
+      endLayoutChange(before);
+  }
 }
 
 
 /**
- * @brief JsonTreeModel::freeTraverse
- *
- * Performs a traversal of the tree starting from the given node.
- * This function is used by the destructor to delete the document tree.
+ * @brief JsonTreeModel::beginLayoutChange
  *
- * @param node: Node at which to start the traversal.
+ * Emit layoutAboutToBeChanged before rows are reordered or hidden.
  *
+ * @return Returns the persistent indexes, to be passed to endLayoutChange().
  */
 
-void JsonTreeModel::freeTraverse(TreeNode *node)
+QModelIndexList JsonTreeModel::beginLayoutChange()
 {
-  for(auto child : node->children) {
-      freeTraverse(child);
-  }
-
-  delete node;
+  emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+  return persistentIndexList();
 }
 
 
 /**
- * @brief JsonTreeModel::traverse
- *
- * Perform a tree traversal from a node that is of type QJsonObject.
- *
- * This function converts the document from QJson* objects into
- * TreeNode structures.
- *
- * The traversal is recursive, for each key/value pair contained in the jobj
- * node.
+ * @brief JsonTreeModel::endLayoutChange
  *
- * @param jobj: Current node; JsonObject
- * @param parent: The parent TreeNode for jobj
- * @param level: Depth of jobj in the tree. Used for debugging/printing node values.
+ * Move the persistent indexes to the new rows of their nodes, invalidate the
+ * ones of nodes that are now hidden, and emit layoutChanged.
  *
- * @see traverse(const QJsonArray &jarr, TreeNode *parent, int level)
+ * @param before: The list returned by beginLayoutChange()
  */
 
-void JsonTreeModel::traverse(const QJsonObject &jobj, TreeNode *parent, int level)
+void JsonTreeModel::endLayoutChange(const QModelIndexList &before)
 {
-  TreeNode *newNode;
+  QModelIndexList after;
 
 
-  for(auto key : jobj.keys()) {
+  for(const QModelIndex &index : before) {
+      TreeNode *node = static_cast<TreeNode *>(index.internalPointer());
+      bool visible = true;
 
-      QJsonValue val = jobj[key];
-      switch(val.type()) {
-
-        case QJsonValue::Type::Object:
-         newNode = new TreeNode(parent, key, val);
-         parent->children.append(newNode);
-         traverse(val.toObject(), newNode, level+1);
-         break;
-
-       case QJsonValue::Type::Array:
-         newNode = new TreeNode(parent, key, val);
-         parent->children.append(newNode);
-         traverse(val.toArray(), newNode, level+1);
-         break;
+      for(TreeNode *n = node; n->parent != nullptr; n = n->parent) {
+          if(n->row() < 0) {
+              visible = false;
+              break;
+          }
+      }
 
-       default:
-         newNode = new TreeNode(parent, key, val);
-         parent->children.append(newNode);
-         break;
-     }
+      after.append(visible ? createIndex(node->row(), index.column(), node) : QModelIndex());
   }
+
+  changePersistentIndexList(before, after);
+  emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
 }
 
 
 /**
- * @brief JsonTreeModel::traverse
- *
- * Perform a tree traversal from a node that is of type QJsonArray.
+ * @brief JsonTreeModel::sort
  *
- * With traverse(QJsonObject &,...) this function converts the document from
- * QJson* objects into TreeNode structures.
+ * Sort the children of every object and array by key (column 0), by value
+ * (column 1) or by one of the subtree statistics. Only the display order
+ * changes; the document keeps its order until restoreOrder() is called.
+ * Items expanded later are sorted as well.
  *
- * The traversal is recursive, for each item in the QJsonArray.
+ * Small containers are sorted concurrently, large ones one after the other
+ * with all cores each; the view is told with a single layoutChanged.
  *
- * @param jarr: Current node; JsonArray
- * @param parent: The parent TreeNode for jarr
- * @param level: Depth of jarr in the tree. Used for debugging/printing node values.
- *
- * @see const QJsonObject &jobj, TreeNode *parent, int level)
+ * @param column: The column to sort by
+ * @param order: The sort order
  */
 
-void JsonTreeModel::traverse(const QJsonArray &jarr, TreeNode *parent, int level)
+void JsonTreeModel::sort(int column, Qt::SortOrder order)
 {
-  TreeNode *newNode;
-
+  QList<TreeNode *> small, large;
 
-  for(int i = 0; i < jarr.size(); i++) {
 
-      QJsonValue val = jarr[i];
-      switch(val.type()) {
+  if(tree.root() == nullptr || column < 0 || column >= columnCount())
+    return;
 
-        case QJsonValue::Type::Object:
-          newNode = new TreeNode(parent, QString(""), val);
-          parent->children.append(newNode);
-          traverse(val.toObject(), newNode, level+1);
-          break;
+  QModelIndexList before = beginLayoutChange();
+  sortColumn = column;
+  sortOrder = order;
 
-        case QJsonValue::Type::Array:
-          newNode = new TreeNode(parent, QString(""), val);
-          parent->children.append(newNode);
-          traverse(val.toArray(), newNode, level+1);
-          break;
+  TreeCore::visit(tree.root(), [column, order, &small, &large](TreeNode *node, int) {
+      if(node->children.count() > 1) {
+          if(node->view == nullptr)
+            node->view = new ChildView;
+          node->view->column = column;
+          node->view->order = order;
+          node->view->field.clear();
 
-        default:
-          newNode = new TreeNode(parent, QString(""), val);
-          parent->children.append(newNode);
-          break;
+          if(node->children.count() < ParallelThreshold)
+            small.append(node);
+          else
+            large.append(node);
       }
-  }
+  });
 
+  QtConcurrent::blockingMap(small, [this](TreeNode *node) { updateView(node); });
+  for(auto node : large)
+    updateView(node);
+  endLayoutChange(before);
 }
 
 
 /**
- * @brief JsonTreeModel::jsonFromVariant
- *
- * Create a QJsonValue object from a QVariant.
+ * @brief JsonTreeModel::sortChildren
  *
- * This function performs some rudimamentary type checking as follows:
- * @li If the variant string contains a '.' character then we attempt to create a double.
- * @li If double conversion fails, try to convert to an integer.
- * @li If double/integer conversion fails, then create a string.
+ * Sort the children of one object or array. With a field name, the elements
+ * of an array of objects are sorted by the value of that member.
  *
- * @param var: The QVariant to convert
- * @return Returns a QJsonValue of type double/integer/string
+ * @param parent: Index of the object or array
+ * @param column: 0 to sort by key, 1 to sort by value, or a statistics column
+ * @param order: The sort order
+ * @param field: Member of the elements to sort by; empty to sort by the elements themselves
  */
 
-QJsonValue JsonTreeModel::jsonFromVariant(const QVariant &var)
+void JsonTreeModel::sortChildren(const QModelIndex &parent, int column, Qt::SortOrder order, const QString &field)
 {
-  double dVal;
-  int iVal;
-  QString sVal;
-  QJsonValue resultValue;
+  TreeNode *node = nodeFromIndex(parent);
 
 
-  sVal = var.toString();
-  try {
-    if(sVal.contains('.') == true) {
-      dVal = std::stod(sVal.toStdString());
-      resultValue = QJsonValue(dVal);
-    }
-    else {
-      iVal = std::stoi(sVal.toStdString());
-      resultValue = QJsonValue(iVal);
-    }
-  }
-  catch(std::invalid_argument /* &ia */) {
-    resultValue = QJsonValue(sVal);
-  }
+  if(node == nullptr || column < 0 || column >= columnCount())
+    return;
+
+  if(canFetchMore(parent))
+    fetchMore(parent);
+
+  // The members are read from the values of the elements, which stay in memory.
+  if(!field.isEmpty())
+    for(auto child : node->children)
+      refault(child);
 
-  return resultValue;
+  QModelIndexList before = beginLayoutChange();
+  if(node->view == nullptr)
+    node->view = new ChildView;
+  node->view->column = field.isEmpty() ? column : 1;
+  node->view->order = order;
+  node->view->field = field;
+  updateView(node);
+  endLayoutChange(before);
 }
 
 
 /**
- * @brief JsonTreeModel::updateNode
- *
- * This function is called from setData(). It is the interface between the UI and the
- * internal TreeNode model.
+ * @brief JsonTreeModel::setFilter
  *
- * Because Qt does everything by value, we have to update the TreeNode as follows:
- * @li Update the values in the current TreeNode
- * @li Get a QJsonObject or QJsonArray object from the node's parent
- * @li For a QJsonObject, remove the old key/value pair and insert the new key/value pair.
- * @li For a QJsonArray, replace the value at index i, which is given by the row in the QModelIndex.
- * @li Replace the parent node's @c data item with the new one.
- * @li Traverse @b up the tree so that the changes are propagated to the root of the document.
- *
- * @param node: The node being updated - starts at the node updated in the UI
- * @param i: The index/row of the node being updated
- * @param oldKey: Old key of the node being updated
- * @param newKey: New key of the node being updated
- * @param value: New value for the node
+ * Show only the children of parent whose key (column 0) or value (column 1)
+ * contains the given text, ignoring case. An empty text removes the filter.
  *
+ * @param parent: Index of the object or array
+ * @param column: The column the text is matched against
+ * @param text: The text to look for
  */
 
-void JsonTreeModel::updateNode(TreeNode *node, int i, const QString oldKey, const QString newKey, const QJsonValue value)
+void JsonTreeModel::setFilter(const QModelIndex &parent, int column, const QString &text)
 {
-  QJsonObject jobj;
-  QJsonArray jarr;
+  TreeNode *node = nodeFromIndex(parent);
 
 
   if(node == nullptr)
     return;
 
+  if(canFetchMore(parent))
+    fetchMore(parent);
 
-  node->key = newKey;
-  node->data = value;
-  if(node->parent != nullptr) {
-      switch(node->parent->data.type()) {
-
-        case QJsonValue::Type::Object:
-          jobj = node->parent->data.toObject();
-          jobj.remove(oldKey);
-          jobj.insert(newKey, value);
-          node->parent->data = QJsonValue(jobj);
-          break;
-
-        case QJsonValue::Type::Array:
-          jarr = node->parent->data.toArray();
-          jarr[i] = value;
-          node->parent->data = QJsonValue(jarr);
-          break;
+  if(node->view == nullptr && text.isEmpty())
+    return;
 
-        default:
-          std::cout << "updateNode: parent type default.\n";
-          break;
-      }
+  QModelIndexList before = beginLayoutChange();
+  if(node->view == nullptr)
+    node->view = new ChildView;
+  node->view->filterColumn = column;
+  node->view->filter = text;
 
-      updateNode(node->parent, node->parent->row(), node->parent->key, node->parent->key, node->parent->data);
+  if(node->view->column < 0 && text.isEmpty()) {
+      delete node->view;
+      node->view = nullptr;
   }
-
+  else {
+      updateView(node);
+  }
+  endLayoutChange(before);
 }
 
 
 /**
- * @brief JsonTreeModel::headerData
- *
- * Provide text for the two headers in the Qt tree view.
- * @note the check for Qt::DisplayRole is required otherwise nothing is displayed.
+ * @brief JsonTreeModel::restoreOrder
  *
- * @param section: The column number
- * @param orientation: Qt allows for horizontal or verticle headings
- * @param role: Qt role.
- *
- * @return Returns a string (as a variant) to use for the column heading.
+ * Remove all sorting and filtering: every item is shown again, in document order.
  */
 
-QVariant JsonTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+void JsonTreeModel::restoreOrder()
 {
-  Q_UNUSED(orientation);
+  if(tree.root() == nullptr)
+    return;
 
-  // Check for DisplayRole is required for Qt to display the header at all.
-  if (role != Qt::DisplayRole)
-      return QVariant();
+  QModelIndexList before = beginLayoutChange();
+  sortColumn = -1;
 
-  if(section == 0)
-    return QVariant(QString("Key"));
-  else
-    return QVariant(QString("Value"));
+  TreeCore::visit(tree.root(), [](TreeNode *node, int) {
+      delete node->view;
+      node->view = nullptr;
+  });
+
+  endLayoutChange(before);
 }
 
 
 /**
- * @brief JsonTreeModel::index
- *
- * This function maps from the Qt abstract model row/column to the model's
- * concept of row/column.
+ * @brief JsonTreeModel::computeStats
  *
- * The @c internalPointer item of QModelIndex stores a pointer to a TreeNode structure.
+ * Compute the statistics of node from the statistics of its children, which
+ * must be up to date, with TreeCore::nodeStats().
  *
- * @param row: The row index of the item under its parent item.
- * @param column: The column index of the item
- * @param parent: The index of the item's parent in the tree view.
- * @return Returns a QModelIndex that locates the corresponding item in the UI;
- * Returns an empty index if the @c row and @c column are out of bounds.
+ * @param node: The node
+ * @return Returns the statistics of node.
+ */
+
+SubtreeStats JsonTreeModel::computeStats(TreeNode *node) const
+{
+  return TreeCore::nodeStats(node, [](TreeNode *child) { return child->subtree; });
+}
+
+
+/**
+ * @brief JsonTreeModel::computeAllStats
  *
+ * Compute the statistics of every node after loading. The tree is split into
+ * levels with TreeCore::levels(), which are computed from the deepest up; the
+ * nodes of a large level are computed on all cores.
  */
 
-QModelIndex JsonTreeModel::index(int row, int column, const QModelIndex &parent) const
+void JsonTreeModel::computeAllStats()
 {
-  TreeNode *parentNode, *childNode;
+  auto compute = [this](TreeNode *node) { node->subtree = computeStats(node); };
 
-  // If the index is out of bounds, return an empty index.
-  if(hasIndex(row, column, parent) == false) {
-      return QModelIndex();
-  }
 
-  // If there is no parent, then Qt is asking us for the index of the root item.
-  if(parent.isValid() == false) {
-    parentNode = root;
-  }
-  else {
-    parentNode = static_cast<TreeNode *>(parent.internalPointer());
-  }
+  if(tree.root() == nullptr || !(options & SubtreeStatistics))
+    return;
 
-  childNode = parentNode->children[row];
-  return createIndex(row, column, childNode);
+  QVector<QVector<TreeNode *>> levels = TreeCore::levels(tree.root());
+  for(int i = levels.count() - 1; i >= 0; i--) {
+      if(levels[i].count() < ParallelThreshold)
+        std::for_each(levels[i].begin(), levels[i].end(), compute);
+      else
+        QtConcurrent::blockingMap(levels[i], compute);
+  }
 }
 
 
 /**
- * @brief JsonTreeModel::parent
+ * @brief JsonTreeModel::updateStats
  *
- * Similar to index(), this function receives a QModelIndex and returns
- * an index for its parent.
+ * Recompute the statistics of an edited node and carry the difference up to
+ * the root. Counts and sizes of the ancestors change by the same amount as
+ * the node's; an ancestor's depth is only recomputed from all of its children
+ * when the child that made it deepest got shallower.
  *
- * @param index: The index to find the parent of
- * @return Returns a QModelIndex for the parent; Returns an empty index if the
- * parent is the root item.
+ * @param node: The edited node, or a container whose children were inserted,
+ * removed or moved
  */
 
-QModelIndex JsonTreeModel::parent(const QModelIndex &index) const
+void JsonTreeModel::updateStats(TreeNode *node)
 {
+  if(!(options & SubtreeStatistics))
+    return;
 
-  if(!index.isValid())
-    return QModelIndex();
+  SubtreeStats before = node->subtree;
+  node->subtree = computeStats(node);
 
-  TreeNode *childNode  = static_cast<TreeNode *>(index.internalPointer());
-  TreeNode *parentNode = childNode->parent;
+  for(TreeNode *child = node; child->parent != nullptr; child = child->parent) {
+      SubtreeStats &up = child->parent->subtree;
+      SubtreeStats upBefore = up;
+      const SubtreeStats &now = child->subtree;
 
-  if(parentNode == root)
-    return QModelIndex();
+      up.nodes += now.nodes - before.nodes;
+      up.bytes += now.bytes - before.bytes;
+      if(now.depth + 1 > up.depth)
+        up.depth = now.depth + 1;
+      else if(now.depth < before.depth && before.depth + 1 == up.depth)
+        up.depth = computeStats(child->parent).depth;
 
-  return createIndex(parentNode->row(), 0, parentNode);
+      before = upBefore;
+  }
 }
 
 
 /**
- * @brief JsonTreeModel::rowCount
+ * @brief JsonTreeModel::emitStatsChanged
  *
- * Returns the number of rows (children) under the parent index.
+ * Tell the view that the statistics columns of the edited nodes and of all
+ * their ancestors changed.
  *
- * @param parent: Index of the parent item
- * @return Returns the number of children under the given parent.
+ * @param edited: The edited nodes
  */
 
-int JsonTreeModel::rowCount(const QModelIndex &parent) const
+void JsonTreeModel::emitStatsChanged(const QList<TreeNode *> &edited)
 {
-  TreeNode *parentNode;
+  QSet<TreeNode *> done;
 
 
-  if(parent.isValid() == false)
-      parentNode = root;
-  else
-      parentNode = static_cast<TreeNode *>(parent.internalPointer());
+  if(!(options & SubtreeStatistics))
+    return;
 
-  return parentNode->children.count();
+  for(auto node : edited) {
+      for(TreeNode *n = node; n != nullptr && n != tree.root(); n = n->parent) {
+          if(done.contains(n))
+            break;
+          done.insert(n);
+
+          if(n->row() >= 0)
+            emit dataChanged(indexFromNode(n, NodesColumn), indexFromNode(n, BytesColumn), QVector<int>() << Qt::DisplayRole);
+      }
+  }
 }
 
 
 /**
- * @brief JsonTreeModel::columnCount
+ * @brief JsonTreeModel::storeColumns
  *
- * Returns the number of columns under the parent index.
+ * With the Columnar load option, store node column-wise if it is a
+ * homogeneous array of objects. The node is then left unpopulated, so its
+ * records and their members need no TreeNodes until it is expanded.
  *
- * @param parent: Index of the parent item
- * @return Returns 2 columns, regardless of parent.
+ * @param node: A node that has no children yet
+ * @return Returns true if node has a ColumnStore.
  */
 
-int JsonTreeModel::columnCount(const QModelIndex &parent) const
+bool JsonTreeModel::storeColumns(TreeNode *node)
 {
-  Q_UNUSED(parent)
+  if(!(options & Columnar) || !node->data.isArray())
+    return false;
 
-  // Two columns: Key, and Value.
-  return 2;
+  node->columns = ColumnStore::build(node->data.toArray());
+  if(node->columns == nullptr)
+    return false;
+
+  qint64 values = qint64(node->columns->rowCount()) * (node->columns->columnCount() + 1);
+  node->populated = false;
+  stats.columnarArrays++;
+  stats.columnarValues += values;
+  stats.logicalNodes += values;
+  return true;
 }
 
 
 /**
- * @brief JsonTreeModel::data
+ * @brief JsonTreeModel::syncColumns
  *
- * Returns a variant holding the data at the given model index.
+ * Bring the ColumnStore that holds an edited node up to date. An edit inside
+ * a record replaces that record in the store; if the record no longer has the
+ * shape of the others, or the array itself was edited, the store is rebuilt,
+ * and dropped if the array is no longer homogeneous.
  *
- * @param index: The index for which to return data
- * @param role: The Qt role; we return an empty variant for all but DisplayRole
- * @return Returns a variant with the data to display at the given model index.
+ * Emits columnsChanged().
+ *
+ * @param node: The edited node, or a container whose children were inserted,
+ * removed or moved
  */
 
-QVariant JsonTreeModel::data(const QModelIndex &index, int role) const
+void JsonTreeModel::syncColumns(TreeNode *node)
 {
+  TreeNode *child = nullptr;
+  TreeNode *n = node;
 
-  if(!index.isValid())
-    return QVariant();
 
-  if(role != Qt::DisplayRole)
-    return QVariant();
+  // A store can only hold the node itself, its parent record or its grandparent.
+  for(int level = 0; level < 3 && n != nullptr; level++, child = n, n = n->parent) {
+      if(n->columns == nullptr)
+        continue;
 
-  // Use the index to retrieve the internal pointer
-  TreeNode *item = static_cast<TreeNode *>(index.internalPointer());
+      if(child != nullptr && n->columns->setRecord(child->pos, n->data.toArray().at(child->pos))) {
+          emit columnsChanged(indexFromNode(n), child->pos);
+          return;
+      }
 
-  // Column 1 is the data item, column 0 is the key
-  if(index.column() == 1)
-    return item->data.toVariant();
-  else {
-      if(item->key.isEmpty()) {
-        QString temp;
+      stats.columnarArrays--;
+      stats.columnarValues -= qint64(n->columns->rowCount()) * (n->columns->columnCount() + 1);
+      delete n->columns;
 
-        temp = temp.sprintf("[%d]", index.row());
-        return QVariant(temp);
+      n->columns = ColumnStore::build(n->data.toArray());
+      if(n->columns != nullptr) {
+          stats.columnarArrays++;
+          stats.columnarValues += qint64(n->columns->rowCount()) * (n->columns->columnCount() + 1);
       }
-      else
-        return QVariant(item->key);
+
+      emit columnsChanged(indexFromNode(n), -1);
+      return;
   }
 }
 
 
 /**
- * @brief JsonTreeModel::setData
+ * @brief JsonTreeModel::columnStore
  *
- * Called by Qt when the user edits an item in the tree view. Either the
- * key (column 0) or the value (column 1) has been changed.
+ * @param array: Index of an array; an invalid index for the root
+ * @return Returns the ColumnStore of the array; nullptr if it is not stored column-wise.
+ */
+
+const ColumnStore *JsonTreeModel::columnStore(const QModelIndex &array) const
+{
+  TreeNode *node = nodeFromIndex(array);
+
+
+  if(node == nullptr)
+    return nullptr;
+
+  return node->columns;
+}
+
+
+/**
+ * @brief JsonTreeModel::setCell
  *
- * The updateNode() function is called to set the new value and to propagate the
- * changes up to the root of the document tree.
+ * Edit one value of an array stored column-wise, as shown in a table view.
+ * The value keeps the type of its column: it is converted to a string or a
+ * boolean, or parsed as a number.
  *
- * Emits the dataChanged signal once the new value is set.
+ * If the record has no TreeNodes, the array (or the record node) is updated
+ * without building them.
  *
- * @param index: The model index of the item that was edited.
- * @param value: The new value provided by the user via the UI.
- * @param role: The Qt role (not used in this function)
- * @return Returns true if the change was made; false otherwise.
+ * @param array: Index of the array; an invalid index for the root
+ * @param row: Index of the record
+ * @param column: Index of the key in ColumnStore::keys()
+ * @param value: The new value
+ * @return Returns true if the value was changed; false if the value does not
+ * fit the type of the column, or a transaction is open.
  */
 
-bool JsonTreeModel::setData(const QModelIndex &index, const QVariant &value, int role)
+bool JsonTreeModel::setCell(const QModelIndex &array, int row, int column, const QVariant &value)
 {
+  TreeNode *node = nodeFromIndex(array);
+  TreeNode *record = nullptr;
+  TreeNode *target = nullptr;
+  QJsonValue newValue, targetValue;
+  QByteArray newRaw;
 
-  if(data(index, role) != value) {
 
-      // Need to get the parent (object or array) and set the key/value
-      // To update only the key, need to first remove the key, then add new key/value.
-      TreeNode *item = static_cast<TreeNode *>(index.internalPointer());
-      if(index.column() == 0) {
+  if(node == nullptr || node->columns == nullptr || transactionOpen)
+    return false;
 
-          // An empty key means the tree item corresponds to an item in a JsonArray.
-          // Edits are disallowed, since it's not really a key.
-          if(value.toString().isEmpty() == true)
-            return false;
+  ColumnStore *store = node->columns;
+  if(row < 0 || row >= store->rowCount() || column < 0 || column >= store->columnCount())
+    return false;
 
-          QString newKey = value.toString();
-          updateNode(item, index.row(), item->key, newKey, item->data);
-      }
-      else {
-          if(index.column() == 1) {
-              QJsonValue newValue = jsonFromVariant(value);
-              updateNode(item, index.row(), item->key, item->key, newValue);
-          }
-      }
+  QString key = store->keys()[column];
+  switch(store->type(column)) {
 
-      modified = true;
-      emit dataChanged(index, index, QVector<int>() << role);
-      return true;
+    case QJsonValue::Type::Bool:
+      newValue = QJsonValue(value.toBool());
+      break;
+
+    case QJsonValue::Type::String:
+      newValue = QJsonValue(value.toString());
+      break;
+
+    default:
+      newValue = jsonFromVariant(value, &newRaw);
+      break;
   }
 
-  return false;
+  if(newValue.type() != store->type(column))
+    return false;
+
+  journal->append(QJsonArray{"cell", QJsonArray::fromStringList(pathOf(node)), row, column, QJsonValue::fromVariant(value)});
+
+  // Replace the number text kept for the field in the RawText of a record
+  // that is not populated.
+  auto setRawText = [&key, &newRaw](QSharedPointer<RawText> &text) {
+      if(text.isNull() && !newRaw.isEmpty())
+        text = QSharedPointer<RawText>::create();
+      if(newRaw.isEmpty() && !text.isNull())
+        text->numbers.remove(key);
+      else if(!newRaw.isEmpty())
+        text->numbers.insert(key, newRaw);
+  };
+
+  // Change the deepest TreeNode that holds the value.
+  if(node->populated)
+    record = node->children[row];
+
+  if(record != nullptr && record->populated) {
+      for(auto field : record->children)
+        if(field->key == key)
+          target = field;
+      if(target != nullptr)
+        target->raw = newRaw;
+      targetValue = newValue;
+  }
+
+  if(target == nullptr && record != nullptr) {
+      QJsonObject jobj = record->data.toObject();
+      jobj.insert(key, newValue);
+      setRawText(record->rawText);
+      target = record;
+      targetValue = jobj;
+  }
+  else if(target == nullptr) {
+      QJsonArray jarr = node->data.toArray();
+      QJsonObject jobj = jarr.at(row).toObject();
+      jobj.insert(key, newValue);
+      jarr.replace(row, jobj);
+
+      if(node->rawText.isNull() && !newRaw.isEmpty())
+        node->rawText = QSharedPointer<RawText>::create();
+      if(!node->rawText.isNull()) {
+          QSharedPointer<RawText> &recordText = node->rawText->children[QString::number(row)];
+          setRawText(recordText);
+      }
+      target = node;
+      targetValue = jarr;
+  }
+
+  updateNode(target, target->pos, target->key, target->key, targetValue);
+  store->setRecord(row, node->data.toArray().at(row));
+  modified = true;
+  updateStats(target);
+
+  if(target != tree.root() && target->row() >= 0) {
+      QModelIndex changed = indexFromNode(target, ValueColumn);
+      emit dataChanged(changed, changed, QVector<int>() << Qt::DisplayRole);
+  }
+  emitStatsChanged(QList<TreeNode *>() << target);
+  refreshViews(QList<TreeNode *>() << target);
+  emit columnsChanged(array, row);
+  return true;
 }
 
 
@@ -595,7 +4275,8 @@ bool JsonTreeModel::setData(const QModelIndex &index, const QVariant &value, int
  *
  * Returns flags for the item at the given model index.
  * An index corresponding to the key of an array item (column 0, empty key)
- * is enabled and selectable but cannot be edited.
+ * is enabled and selectable but cannot be edited. The same holds for the
+ * ancestors of a partial document, and for the key of its target.
  *
  * All other items are enabled, selectable, and editable.
  *
@@ -610,8 +4291,12 @@ Qt::ItemFlags JsonTreeModel::flags(const QModelIndex &index) const
 
   TreeNode *item = static_cast<TreeNode *>(index.internalPointer());
 
-  // Do not allow edits on keys of array items.
-  if(item->key.isEmpty() && index.column() == 0)
+  // Do not allow edits on keys of array items, or on the statistics.
+  if((item->key.isEmpty() && index.column() == 0) || index.column() > ValueColumn)
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+
+  // The path of a partial document is kept until loadRest().
+  if(onSeekPath(item) && (index.column() == 0 || item != seekPath.last()))
     return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
   else
     return Qt::ItemIsEditable | Qt::ItemIsEnabled | Qt::ItemIsSelectable;
@@ -30,6 +30,56 @@ SOFTWARE.
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include <QHash>
+#include <QDateTime>
+#include <QMultiHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include "columnstore.h"
+#include "jsonstream.h"
+#include "cborstream.h"
+#include "jsonsnapshot.h"
+#include "jsonschema.h"
+#include "editjournal.h"
+#include "jsontreecore.h"
+
+
+struct TreeNode;
+
+
+/**
+ * @brief The SortKey struct
+ *
+ * Sort key of a TreeNode, computed once when the children of its parent
+ * are sorted, and again only when the node is edited.
+ */
+struct SortKey {
+
+  int      rank;    /**< Orders values of different types: null, bool, number, string, container, missing field */
+  double   number;  /**< Value of booleans and numbers; the index of array items sorted by key */
+  QString  text;    /**< Text of strings and of object keys */
+};
+
+
+/**
+ * @brief The ChildView struct
+ *
+ * Display order of the children of a sorted or filtered TreeNode.
+ * The @c children list of the node itself always stays in document order.
+ */
+struct ChildView {
+
+  QVector<TreeNode *> rows;         /**< Visible children, in display order */
+  QVector<SortKey>    keys;         /**< Sort key of every child, indexed by TreeNode::pos */
+  int                 column;       /**< Sort column; -1 keeps the document order */
+  Qt::SortOrder       order;        /**< Sort order */
+  QString             field;        /**< If not empty, array elements are sorted by this child field */
+  int                 filterColumn; /**< Column the filter text is matched against */
+  QString             filter;       /**< Children whose text does not contain this string are hidden */
+
+  ChildView() : column(-1), order(Qt::AscendingOrder), filterColumn(0) {}
+};
 
 
 /**
@@ -37,37 +87,59 @@ SOFTWARE.
  *
  * Used as the internalpointer member of QModelIndex objects.
  * This structure is used to map the internal model to Qt's QAbstractItemModel
- * paradigm.
+ * paradigm. The key, value and children are those of a JsonTreeCore node;
+ * the members below are used by the model only.
  *
  */
-struct TreeNode {
+struct TreeNode : BasicTreeNode<QtJsonTraits, TreeNode> {
 
-  TreeNode          *parent;    /**< Address of the parent TreeNode (nullptr for root) */
-  QList<TreeNode *>  children;  /**< List of chil elements under this node */
-  QString            key;       /**< The key by which this node is known (displayed in column 0).
-                                  This string is empty ("") for array elements. */
-  QJsonValue         data;      /**< The value of the node. This is displayed in the tree view. */
+  ChildView         *view;      /**< Display order of the children; nullptr for document order */
+  int                vpos;      /**< Row of this node in the ChildView of its parent; -1 if filtered out */
+  SubtreeStats       subtree;   /**< Size of the subtree of this node */
+  ColumnStore       *columns;   /**< Column-wise copy of a homogeneous array of objects; nullptr otherwise */
+  QByteArray         raw;       /**< Text of a number as read from the file, if it is not written back the
+                                  same way; empty otherwise */
+  QSharedPointer<RawText> rawText; /**< Such texts of the numbers below a container that is not populated */
+  bool               expanded;  /**< True while the node is expanded in the view; see JsonTreeModel::setExpanded() */
+  bool               evicted;   /**< True while the subtree is evicted by the memory budget */
+  quint64            lastUse;   /**< Time of the last expansion or collapse, used to evict the least recently used */
+  SourceRange        range;     /**< Text of the value in the file read on demand; empty if not known or edited since */
+  bool               unloaded;  /**< True while the value is only in the file: data is an empty placeholder
+                                  until JsonTreeModel::refault() reads it */
+  QHash<QString, SourceRange> pending; /**< Ranges of the members that are only in the file, until populate()
+                                         builds their nodes */
 
 
-  TreeNode(TreeNode *p, const QString &k, const QJsonValue &d) : parent(p), key(k), data(d) {}
-  ~TreeNode() {}
+  TreeNode(TreeNode *p, const QString &k, const QJsonValue &d) : BasicTreeNode(p, k, d), view(nullptr), vpos(0), columns(nullptr),
+    expanded(false), evicted(false), lastUse(0), unloaded(false) {}
+  ~TreeNode() { delete view; delete columns; }
 
   /**
    * @brief row
    *
    * @return Returns an integer corresponding to the row of this node under its
-   * parent. For the root of the tree, the row count is always 0.
+   * parent, as shown in the view. For the root of the tree, the row count is always 0.
+   * Returns -1 for a node hidden by a filter on its parent.
    */
   int row() const {
 
-    if(parent != nullptr)
-      return parent->children.indexOf(const_cast<TreeNode *>(this));
+    if(parent == nullptr)
+      return 0;
 
-    return 0;
+    if(parent->view != nullptr)
+      return vpos;
+
+    return pos;
   }
 };
 
 
+/**
+ * @brief The tree of TreeNodes, as a JsonTreeCore.
+ */
+typedef JsonTreeCore<QtJsonTraits, TreeNode> TreeCore;
+
+
 /**
  * @brief The JsonTreeModel class
  *
@@ -79,26 +151,198 @@ class JsonTreeModel : public QAbstractItemModel
 {
   Q_OBJECT
 
+public:
+  /**
+   * @brief Options accepted by the loading constructor.
+   */
+  enum LoadOption {
+    NoLoadOptions     = 0x0,  /**< Build one TreeNode per JSON value. */
+    Deduplicate       = 0x1,  /**< Store identical subtrees once (see share()). */
+    SubtreeStatistics = 0x2,  /**< Show the size of every subtree in extra columns. */
+    Columnar          = 0x4,  /**< Store homogeneous arrays of objects column-wise (see ColumnStore). */
+    OnDemand          = 0x8   /**< Read plain JSON files one level at a time (see setMemoryBudget()); not with the options above. */
+  };
+  Q_DECLARE_FLAGS(LoadOptions, LoadOption)
+
+  /**
+   * @brief Encodings of a document file.
+   */
+  enum FileFormat {
+    JsonFormat,   /**< JSON text */
+    CborFormat    /**< CBOR (RFC 7049) */
+  };
+
+  /**
+   * @brief Roles of data() besides Qt::DisplayRole.
+   */
+  enum Role {
+    ViolationsRole = Qt::UserRole + 1   /**< QStringList of the schema violations of the item */
+  };
+
+  /**
+   * @brief The columns of the model. The statistics columns are only
+   * present with the SubtreeStatistics load option.
+   */
+  enum Column {
+    KeyColumn   = 0,  /**< Key, or [n] for array items */
+    ValueColumn = 1,  /**< Value */
+    NodesColumn = 2,  /**< Number of values in the subtree */
+    DepthColumn = 3,  /**< Number of levels in the subtree */
+    BytesColumn = 4   /**< Approximate size of the subtree as JSON */
+  };
+
+  /**
+   * @brief Node counts and sizes used to report the memory held by the model.
+   */
+  struct MemoryStats {
+    qint64 logicalNodes;      /**< Nodes in the document as parsed, including the root */
+    qint64 materializedNodes; /**< TreeNode objects currently allocated */
+    qint64 sharedSubtrees;    /**< Containers stored as a reference to an identical, earlier subtree */
+    qint64 columnarArrays;    /**< Arrays stored in a ColumnStore */
+    qint64 columnarValues;    /**< Values held in ColumnStores instead of TreeNodes */
+    qint64 evictions;         /**< Subtrees evicted to stay within the memory budget */
+    qint64 refaults;          /**< Evicted subtrees read or built again when expanded */
+    qint64 documentBytes;     /**< Size of the text the document was read from */
+    qint64 sourceBytes;       /**< Bytes of that text whose values are only in the file */
+  };
+
 private:
+  /**
+   * @brief State of a node before its first edit in the open transaction.
+   */
+  struct Original {
+    QString    key;     /**< Key before the transaction */
+    QJsonValue data;    /**< Value before the transaction */
+    QByteArray raw;     /**< Number text before the transaction */
+    int        columns; /**< Bit mask of the columns edited in the transaction */
+  };
+
   bool           modified;
-  TreeNode      *root;
+  TreeCore       tree;
+  LoadOptions    options;
+  FileFormat     format;
+  qint64         errorAt;
+  quint64        documentVersion;
+  MemoryStats    stats;
+  qint64         budget;
+  quint64        useClock;
+  QMultiHash<uint, QJsonValue> shareTable;
+
+  int            sortColumn;
+  Qt::SortOrder  sortOrder;
+
+  bool           transactionOpen;
+  bool           modifiedBeforeTransaction;
+  QHash<TreeNode *, Original> originals;
+
+  QString        sourceFile;
+  QString        rangeFile;
+  qint64         rangeSize;
+  QDateTime      rangeTime;
+  QStringList    seekTokens;
+  QVector<TreeNode *> seekPath;
+
+  JsonSchema     schema;
+  QMap<QString, QStringList> violations;
+  QVector<QStringList> edits;
+  bool           fullValidation;
+  bool           validating;
+  QFutureWatcher<SchemaViolations> *validation;
+  EditJournal   *journal;
 
   std::string indent(int level);
   void freeTraverse(TreeNode *node);
-  void traverse(const QJsonObject &jobj, TreeNode *parent, int level);
-  void traverse(const QJsonArray &jarr, TreeNode *parent, int level);
+  TreeNode *addChild(TreeNode *parent, const QString &key, const QJsonValue &val, int row = -1);
+  void traverse(TreeNode *node);
+  bool share(TreeNode *node, uint hash, qint64 values);
+  void populate(TreeNode *node);
+  bool refault(TreeNode *node);
+  void writeUp(TreeNode *node, int i, const QString &oldKey);
+  TreeNode *nodeFromIndex(const QModelIndex &index) const;
+  QString uniqueKey(const QJsonObject &jobj, const QString &base) const;
+  void propagate(TreeNode *node);
+  QModelIndex indexFromNode(TreeNode *node, int column = 0) const;
+  void applyChanges(TreeNode *node, const QList<TreeNode *> &changed);
+  void emitChanged();
+  SortKey sortKey(TreeNode *node, const ChildView *view) const;
+  QString filterText(TreeNode *node, const ChildView *view) const;
+  void updateView(TreeNode *node);
+  void reposition(TreeNode *node, TreeNode *child);
+  void refreshViews(const QList<TreeNode *> &edited);
+  QModelIndexList beginLayoutChange();
+  void endLayoutChange(const QModelIndexList &before);
+  SubtreeStats computeStats(TreeNode *node) const;
+  void computeAllStats();
+  void updateStats(TreeNode *node);
+  void emitStatsChanged(const QList<TreeNode *> &edited);
+  bool storeColumns(TreeNode *node);
+  void syncColumns(TreeNode *node);
   void updateNode(TreeNode *node, int i, const QString oldKey, const QString newKey, const QJsonValue value);
-  QJsonValue jsonFromVariant(const QVariant &var);
+  QJsonValue jsonFromVariant(const QVariant &var, QByteArray *raw);
+  QSharedPointer<RawText> collectRawText(TreeNode *top) const;
+  void enforceBudget();
+  bool evict(TreeNode *node);
+  bool unload(TreeNode *node);
+  qint64 sourceBytes(TreeNode *node) const;
+  qint64 residentBytes() const;
+  bool readUnloaded(QHash<TreeNode *, QJsonValue> *values, QHash<TreeNode *, QSharedPointer<RawText>> *texts) const;
+  QJsonValue document(QSharedPointer<RawText> *text) const;
+  QJsonValue readFile(const QString &file, QJsonParseError *err, QSharedPointer<RawText> *text,
+                      QHash<QString, SourceRange> *ranges = nullptr);
+  void rebuild(const QJsonValue &value, const QSharedPointer<RawText> &text,
+               const QHash<QString, SourceRange> &ranges = QHash<QString, SourceRange>());
+  bool onSeekPath(TreeNode *node) const;
+  QStringList pathOf(TreeNode *node) const;
+  TreeNode *nodeForPath(const QStringList &path) const;
+  void noteEdit(TreeNode *node);
+  void startValidation();
+  void validationFinished();
+  bool replay(const QJsonArray &record);
 
 public:
   explicit JsonTreeModel(QObject *parent = nullptr);
   JsonTreeModel(const QString &file, QJsonParseError *err, QObject *parent = nullptr);
+  JsonTreeModel(const QString &file, QJsonParseError *err, LoadOptions opts, QObject *parent = nullptr);
+  JsonTreeModel(const QString &file, const QString &pointer, QJsonParseError *err, LoadOptions opts, QObject *parent = nullptr);
   virtual ~JsonTreeModel() override;
 
   bool isModified();
   void resetModified();
+  MemoryStats memoryStats() const;
+  const TreeCore &core() const;
+  void releaseTree();
+  void setMemoryBudget(qint64 bytes);
+  qint64 memoryBudget() const;
+  bool releaseFile(const QString &file);
+  void setExpanded(const QModelIndex &index, bool expanded);
+
+  bool beginTransaction();
+  bool commitTransaction();
+  void rollbackTransaction();
+  bool inTransaction() const;
 
   QJsonDocument toJsonDocument();
+  JsonSnapshot snapshot() const;
+  quint64 version() const;
+  bool write(QIODevice *dev, FileFormat fmt = JsonFormat);
+  FileFormat fileFormat() const;
+  qint64 errorOffset() const;
+  static FileFormat formatForFile(const QString &file);
+
+  bool isPartial() const;
+  bool loadRest(QJsonParseError *err);
+  QModelIndex indexForPointer(const QString &pointer);
+
+  // Crash recovery:
+  bool startJournal(const QString &file, QString *error);
+  void stopJournal();
+  int recoverJournal(QString *error);
+
+  // Schema validation:
+  void setSchema(const JsonSchema &compiled);
+  bool hasSchema() const;
+  int violationCount() const;
+  QStringList violationsOf(const QString &pointer) const;
 
   // Header:
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
@@ -109,10 +353,47 @@ public:
 
   int rowCount(const QModelIndex &parent = QModelIndex()) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
 
   QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
   bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 
   Qt::ItemFlags flags(const QModelIndex& index) const override;
 
+  // Sorting and filtering:
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+  void sortChildren(const QModelIndex &parent, int column, Qt::SortOrder order = Qt::AscendingOrder,
+                    const QString &field = QString());
+  void setFilter(const QModelIndex &parent, int column, const QString &text);
+  void restoreOrder();
+
+  // Column-wise arrays:
+  const ColumnStore *columnStore(const QModelIndex &array) const;
+  bool setCell(const QModelIndex &array, int row, int column, const QVariant &value);
+
+  // Structural editing:
+  bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+  bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+  bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                const QModelIndex &destinationParent, int destinationChild) override;
+
+signals:
+  /**
+   * @brief Emitted when the ColumnStore of an array changed.
+   * @param array: Index of the array
+   * @param row: The edited record; -1 if the store was rebuilt or dropped
+   */
+  void columnsChanged(const QModelIndex &array, int row);
+
+  /**
+   * @brief Emitted when the results of a schema validation were merged.
+   * @param violations: Number of values with violations in the document
+   */
+  void validated(int violations);
+
 };
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(JsonTreeModel::LoadOptions)
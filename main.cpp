@@ -22,13 +22,232 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <iostream>
 #include <QApplication>
+#include <QElapsedTimer>
 #include "mainwindow.h"
+#include "jsontreemodel.h"
+#include "jsontreecore.h"
+
+
+/**
+ * @brief coreWalk
+ *
+ * Visit every built node of a JsonTreeCore, reading its key and value
+ * directly.
+ *
+ * @param top: Root of the tree, built beforehand
+ * @param nodes: Set to the number of nodes visited
+ * @param chars: Set to the number of characters of keys and strings read
+ * @return Returns the time taken, in milliseconds.
+ */
+template<typename Core>
+static qint64 coreWalk(typename Core::Node *top, qint64 *nodes, qint64 *chars)
+{
+  QElapsedTimer timer;
+  qint64 count = 0, text = 0;
+
+
+  timer.start();
+  Core::visit(top, [&count, &text](typename Core::Node *node, int) {
+      count++;
+      text += node->key.size();
+      if(node->data.isString())
+        text += node->data.toString().size();
+  });
+  *nodes = count;
+  *chars = text;
+  return timer.elapsed();
+}
+
+
+/**
+ * @brief modelWalk
+ *
+ * Visit every item of a model through the QAbstractItemModel API: index(),
+ * rowCount() and data(), fetching the items that are not built yet.
+ *
+ * @param model: The model
+ * @param nodes: Set to the number of items visited, including the root
+ * @param chars: Set to the number of characters of keys and values read
+ * @return Returns the time taken, in milliseconds.
+ */
+static qint64 modelWalk(JsonTreeModel &model, qint64 *nodes, qint64 *chars)
+{
+  QElapsedTimer timer;
+  QVector<QModelIndex> stack;
+  qint64 count = 1, text = 0;
+
+
+  timer.start();
+  stack.append(QModelIndex());
+  while(!stack.isEmpty()) {
+      QModelIndex parent = stack.takeLast();
+      if(model.canFetchMore(parent))
+        model.fetchMore(parent);
+
+      for(int row = 0; row < model.rowCount(parent); row++) {
+          QModelIndex key = model.index(row, 0, parent);
+          text += model.data(key).toString().size();
+          if(model.hasChildren(key))
+            stack.append(key);
+          else
+            text += model.data(model.index(row, 1, parent)).toString().size();
+          count++;
+      }
+  }
+  *nodes = count;
+  *chars = text;
+  return timer.elapsed();
+}
+
+
+/**
+ * @brief cellChars
+ * @return Returns the characters shown for a cell of a table: the length of a
+ * string, 1 for other values.
+ */
+static qint64 cellChars(const QJsonValue &value)
+{
+  return value.isString() ? value.toString().size() : 1;
+}
+
+
+/**
+ * @brief columnarBenchmark
+ *
+ * Weigh the ColumnStores of a file against the alternatives: TreeNodes for
+ * every record and member, as without the Columnar option, and reading the
+ * cells straight from the records in the document. Prints the approximate
+ * memory of the stores and of the TreeNodes, and the time taken to read
+ * every cell each way, as a table view does while scrolling.
+ *
+ * @param file: Name of a JSON file
+ */
+static void columnarBenchmark(const QString &file)
+{
+  QJsonParseError err;
+  JsonTreeModel model(file, &err, JsonTreeModel::Columnar);
+  QVector<TreeNode *> arrays;
+  QElapsedTimer timer;
+  qint64 cells = 0, storeBytes = 0, nodeBytes = 0, storeChars = 0, recordChars = 0, nodeChars = 0;
+  qint64 storeTime = 0, recordTime = 0, nodeTime = 0;
+
+
+  if(err.error != QJsonParseError::NoError || model.core().root() == nullptr)
+    return;
+
+  TreeCore::visit(model.core().root(), [&arrays](TreeNode *node, int) {
+      if(node->columns != nullptr)
+        arrays.append(node);
+  });
+
+  if(arrays.isEmpty()) {
+      std::cout << "No homogeneous arrays of objects to store column-wise." << std::endl;
+      return;
+  }
+
+  for(auto node : arrays) {
+      const ColumnStore *store = node->columns;
+      QJsonArray jarr = node->data.toArray();
+      TreeCore records(node->data);
+
+      cells += qint64(store->rowCount()) * store->columnCount();
+      storeBytes += store->bytes();
+
+      records.visitAll([&nodeBytes](TreeNode *n, int) {
+          nodeBytes += sizeof(TreeNode) + n->children.size() * qint64(sizeof(TreeNode *))
+                       + n->key.capacity() * qint64(sizeof(QChar));
+      });
+
+      timer.start();
+      for(int row = 0; row < store->rowCount(); row++)
+        for(int column = 0; column < store->columnCount(); column++)
+          storeChars += cellChars(store->value(row, column));
+      storeTime += timer.nsecsElapsed();
+
+      timer.start();
+      for(int row = 0; row < jarr.size(); row++) {
+          QJsonObject record = jarr.at(row).toObject();
+          for(const QString &key : store->keys())
+            recordChars += cellChars(record.value(key));
+      }
+      recordTime += timer.nsecsElapsed();
+
+      timer.start();
+      for(auto record : records.root()->children)
+        for(auto member : record->children)
+          nodeChars += cellChars(member->data);
+      nodeTime += timer.nsecsElapsed();
+  }
+
+  std::cout << "Columnar: " << arrays.count() << " arrays, " << cells << " cells" << std::endl;
+  std::cout << "ColumnStore:             " << storeBytes / 1024 << " KiB, all cells read in "
+            << storeTime / 1000 << " us (" << storeChars << " chars)" << std::endl;
+  std::cout << "records in the document: no extra memory, all cells read in "
+            << recordTime / 1000 << " us (" << recordChars << " chars)" << std::endl;
+  std::cout << "TreeNodes:               " << nodeBytes / 1024 << " KiB, all cells read in "
+            << nodeTime / 1000 << " us (" << nodeChars << " chars)" << std::endl;
+}
+
+
+/**
+ * @brief benchmark
+ *
+ * Compare a traversal of a file through the QAbstractItemModel API with a
+ * traversal of the same nodes through JsonTreeCore, and with JsonTreeCores
+ * of other policies, and print the times. Every tree is built completely
+ * before it is timed, so only the walks are compared. Then compare the
+ * ColumnStores of the file with their alternatives; see columnarBenchmark().
+ *
+ * @param file: Name of a JSON file
+ * @return Returns the exit code of the program.
+ */
+static int benchmark(const QString &file)
+{
+  QJsonParseError err;
+  JsonTreeModel model(file, &err);
+  qint64 modelNodes, modelChars, coreNodes, coreChars, utf8Nodes, utf8Chars, eagerNodes, eagerChars;
+
+
+  if(err.error != QJsonParseError::NoError) {
+      std::cerr << qPrintable(file) << ": " << qPrintable(err.errorString()) << std::endl;
+      return 1;
+  }
+
+  // The first walk fetches the items that are not built yet.
+  modelWalk(model, &modelNodes, &modelChars);
+
+  JsonTreeCore<Utf8KeyTraits> utf8(model.snapshot().root());
+  JsonTreeCore<EagerVectorTraits> eager(model.snapshot().root());
+  utf8.visitAll([](JsonTreeCore<Utf8KeyTraits>::Node *, int) {});
+
+  qint64 modelTime = modelWalk(model, &modelNodes, &modelChars);
+  qint64 coreTime = coreWalk<TreeCore>(model.core().root(), &coreNodes, &coreChars);
+  qint64 utf8Time = coreWalk<JsonTreeCore<Utf8KeyTraits>>(utf8.root(), &utf8Nodes, &utf8Chars);
+  qint64 eagerTime = coreWalk<JsonTreeCore<EagerVectorTraits>>(eager.root(), &eagerNodes, &eagerChars);
+
+  std::cout << "Walks only, every tree built beforehand:" << std::endl;
+  std::cout << "model API:               " << modelNodes << " items, " << modelChars << " chars, "
+            << modelTime << " ms" << std::endl;
+  std::cout << "model tree, TreeCore:    " << coreNodes << " nodes, " << coreChars << " chars, "
+            << coreTime << " ms" << std::endl;
+  std::cout << "core, Utf8KeyTraits:     " << utf8Nodes << " nodes, " << utf8Chars << " chars, "
+            << utf8Time << " ms" << std::endl;
+  std::cout << "core, EagerVectorTraits: " << eagerNodes << " nodes, " << eagerChars << " chars, "
+            << eagerTime << " ms" << std::endl;
+
+  columnarBenchmark(file);
+  return 0;
+}
+
 
 /**
  * @brief main
  *
  * Entry point for the application.
+ * With the arguments "--benchmark file.json", times a traversal of the file
+ * through the model and through JsonTreeCore instead of opening the window.
  *
  * @param argc
  * @param argv
@@ -37,6 +256,11 @@ SOFTWARE.
  */
 int main(int argc, char *argv[])
 {
+  if(argc == 3 && QString(argv[1]) == QString("--benchmark")) {
+      QCoreApplication a(argc, argv);
+      return benchmark(QString::fromLocal8Bit(argv[2]));
+  }
+
   QApplication a(argc, argv);
   MainWindow w;
   w.show();
@@ -22,9 +22,18 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <QElapsedTimer>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QTableView>
 #include "mainwindow.h"
+#include "jsontablemodel.h"
+#include "compresseddevice.h"
+#include "jsonpointer.h"
+#include "editjournal.h"
 #include "ui_mainwindow.h"
 
 
@@ -34,12 +43,42 @@ SOFTWARE.
  *
  * Initialize the UI.
  * Model pointer is initially nullptr.
+ *
+ * Clicking a column header sorts the model by that column; the sort
+ * indicator starts hidden, since the document is shown in its own order.
+ * A filter field and the memory budget are added to the tool bar.
  */
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
   ui->setupUi(this);
   ptm = nullptr;
+  fileFormat = JsonTreeModel::JsonFormat;
+
+  ui->treeView->header()->setSectionsClickable(true);
+  ui->treeView->header()->setSortIndicatorShown(true);
+  ui->treeView->header()->setSortIndicator(-1, Qt::AscendingOrder);
+  connect(ui->treeView->header(), &QHeaderView::sortIndicatorChanged, this, &MainWindow::sortItems);
+
+  filterEdit = new QLineEdit(this);
+  filterEdit->setPlaceholderText("Filter");
+  filterEdit->setClearButtonEnabled(true);
+  filterEdit->setMaximumWidth(200);
+  ui->mainToolBar->addWidget(filterEdit);
+  connect(filterEdit, &QLineEdit::returnPressed, this, &MainWindow::filterItems);
+
+  budgetBox = new QSpinBox(this);
+  budgetBox->setRange(0, 1024 * 1024);
+  budgetBox->setSingleStep(64);
+  budgetBox->setSuffix(" MiB");
+  budgetBox->setSpecialValueText("No budget");
+  budgetBox->setToolTip("Memory budget for the document; collapsed items are evicted beyond it.\n"
+                        "JSON files opened with a budget are read from the file as they are expanded.");
+  ui->mainToolBar->addWidget(budgetBox);
+  connect(budgetBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &MainWindow::setBudget);
+
+  connect(ui->treeView, &QTreeView::expanded, this, &MainWindow::itemExpanded);
+  connect(ui->treeView, &QTreeView::collapsed, this, &MainWindow::itemCollapsed);
 }
 
 /**
@@ -86,6 +125,8 @@ int MainWindow::querySave()
               res = 0;
               break;
             case QMessageBox::Discard:
+              // The edits are given up: their journal must not offer them for recovery.
+              ptm->stopJournal();
               res = 0;
               break;
             case QMessageBox::Cancel:
@@ -98,11 +139,93 @@ int MainWindow::querySave()
   return res;
 }
 
+/**
+ * @brief transferRate
+ *
+ * Describe how fast a file was read or written, to compare formats.
+ *
+ * @param verb: "Read" or "Wrote"
+ * @param format: Encoding of the file
+ * @param bytes: Size of the file
+ * @param msecs: Time taken
+ * @return Returns e.g. "Read 12.0 MiB of CBOR in 40 ms (300.0 MiB/s)".
+ */
+
+static QString transferRate(const QString &verb, JsonTreeModel::FileFormat format, qint64 bytes, qint64 msecs)
+{
+  double mebibytes = bytes / (1024.0 * 1024.0);
+
+
+  return QString("%1 %2 MiB of %3 in %4 ms (%5 MiB/s)").arg(verb).arg(mebibytes, 0, 'f', 1)
+           .arg(format == JsonTreeModel::CborFormat ? "CBOR" : "JSON").arg(msecs)
+           .arg(mebibytes * 1000.0 / qMax(msecs, qint64(1)), 0, 'f', 1);
+}
+
+
+/**
+ * @brief MainWindow::loadOptions
+ * @return Returns the load options checked in the tool bar.
+ */
+
+JsonTreeModel::LoadOptions MainWindow::loadOptions() const
+{
+  JsonTreeModel::LoadOptions options;
+
+
+  if(ui->actionShare->isChecked())
+    options |= JsonTreeModel::Deduplicate;
+  if(ui->actionStats->isChecked())
+    options |= JsonTreeModel::SubtreeStatistics;
+  if(ui->actionColumnar->isChecked())
+    options |= JsonTreeModel::Columnar;
+  if(budgetBox->value() > 0)
+    options |= JsonTreeModel::OnDemand;
+
+  return options;
+}
+
+
+/**
+ * @brief MainWindow::showModel
+ *
+ * Show a newly loaded model in the tree view, and free the previous one.
+ *
+ * @param model: The new model
+ * @param jsonFile: Name of its file
+ * @param report: How long it took to load, shown in the status bar
+ */
+
+void MainWindow::showModel(JsonTreeModel *model, const QString &jsonFile, const QString &report)
+{
+  JsonTreeModel *oldModel = ptm;
+
+
+  ptm = model;
+  fileFormat = ptm->fileFormat();
+  transfer = report;
+  ui->treeView->setModel(ptm);
+  ptm->setMemoryBudget(qint64(budgetBox->value()) * 1024 * 1024);
+  connect(ptm, &JsonTreeModel::validated, this, &MainWindow::showViolations);
+  ptm->setSchema(schema);
+
+  // Free the old model; its tree is freed on a worker thread
+  if(oldModel != nullptr) {
+      oldModel->releaseTree();
+      delete oldModel;
+    }
+  ui->treeView->header()->setSortIndicator(-1, Qt::AscendingOrder);
+  filterEdit->clear();
+  ui->currentFile->setText(jsonFile);
+  showMemoryStats();
+}
+
+
 /**
  * @brief MainWindow::openFile
  *
  * Slot connected to the triggered signal of actionOpenFile.
  * Presents a system File Open dialog to the user.
+ * JSON and CBOR files are both accepted; the load time is reported.
  */
 
 void MainWindow::openFile()
@@ -110,6 +233,7 @@ void MainWindow::openFile()
   QString         jsonFile;
   QJsonParseError err;
   JsonTreeModel  *tempModel;
+  QElapsedTimer   timer;
 
 
   if(querySave() >= 0) {
@@ -117,57 +241,566 @@ void MainWindow::openFile()
       jsonFile = QFileDialog::getOpenFileName(this, QString("Open JSON File"), QString("/"));
       if(jsonFile.isNull() == false) {
 
-          tempModel = new JsonTreeModel(jsonFile, &err, this);
+          timer.start();
+          tempModel = new JsonTreeModel(jsonFile, &err, loadOptions(), this);
           if(err.error == QJsonParseError::NoError) {
-
-              // Free the old model
-              if(ptm != nullptr) {
-                  ui->treeView->setModel(nullptr);
-                  delete ptm;
-                }
-
-              // Set the new model
-              ptm = tempModel;
-              ui->treeView->setModel(ptm);
-              ui->currentFile->setText(jsonFile);
-
+              QString report = transferRate("Read", tempModel->fileFormat(), QFileInfo(jsonFile).size(), timer.elapsed());
+              QString journalError;
+              int recovered = -1;
+
+              // The old model's journal goes first: it may be the journal of this
+              // same file, which the new model is about to recover or replace.
+              if(ptm != nullptr)
+                ptm->stopJournal();
+
+              // Replayed before the model is shown, so the view is not updated for every edit.
+              if(EditJournal::canRecover(jsonFile) &&
+                 QMessageBox::question(this, "Recover edits?", "This file has unsaved edits from a session that ended unexpectedly. Recover them?",
+                                       QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) == QMessageBox::Yes) {
+                  timer.restart();
+                  recovered = tempModel->recoverJournal(&journalError);
+                  report += QString("; recovered %1 edits in %2 ms").arg(recovered).arg(timer.elapsed());
+              }
+              else {
+                  tempModel->startJournal(jsonFile, &journalError);
+              }
+
+              if(!journalError.isEmpty())
+                report += "; no journal: " + journalError;
+
+              seekPointer.clear();
+              showModel(tempModel, jsonFile, report);
             }
           else {
-              ui->statusBar->showMessage(err.errorString() + " at position " + QString::number(err.offset));
+              ui->statusBar->showMessage(err.errorString() + " at position " + QString::number(tempModel->errorOffset()));
             }
       }
   }
 }
 
 
+/**
+ * @brief MainWindow::seekFile
+ *
+ * Slot connected to the triggered signal of actionSeek.
+ * Asks for a JSON Pointer and a file, and opens only the value the pointer
+ * refers to, which becomes the current item. "Load All" reads the rest.
+ */
+
+void MainWindow::seekFile()
+{
+  QString         jsonFile;
+  QString         pointer;
+  QStringList     tokens;
+  QJsonParseError err;
+  JsonTreeModel  *tempModel;
+  QElapsedTimer   timer;
+  bool            ok;
+
+
+  if(querySave() < 0)
+    return;
+
+  pointer = QInputDialog::getText(this, QString("Seek"), QString("JSON Pointer, e.g. /store/books/3:"),
+                                  QLineEdit::Normal, seekPointer, &ok);
+  if(!ok)
+    return;
+
+  if(!JsonPointer::tokens(pointer, &tokens)) {
+      ui->statusBar->showMessage("Not a JSON Pointer: " + pointer);
+      return;
+  }
+
+  jsonFile = QFileDialog::getOpenFileName(this, QString("Open JSON File"), QString("/"));
+  if(jsonFile.isNull())
+    return;
+
+  timer.start();
+  tempModel = new JsonTreeModel(jsonFile, pointer, &err, loadOptions(), this);
+  if(err.error != QJsonParseError::NoError) {
+      ui->statusBar->showMessage(err.errorString() + " at position " + QString::number(tempModel->errorOffset()));
+      delete tempModel;
+      return;
+  }
+
+  seekPointer = pointer;
+  showModel(tempModel, jsonFile, QString("Found %1 in %2 ms").arg(pointer).arg(timer.elapsed()));
+
+  QModelIndex target = ptm->indexForPointer(pointer);
+  if(target.isValid()) {
+      ui->treeView->setCurrentIndex(target);
+      ui->treeView->scrollTo(target);
+  }
+}
+
+
+/**
+ * @brief MainWindow::loadAll
+ *
+ * Slot connected to the triggered signal of actionLoadAll.
+ * Reads the rest of a document opened with seekFile(), keeping the edits of
+ * the sought value, and makes that value the current item again.
+ */
+
+void MainWindow::loadAll()
+{
+  QJsonParseError err;
+  QElapsedTimer   timer;
+
+
+  if(ptm == nullptr || !ptm->isPartial())
+    return;
+
+  timer.start();
+  if(!ptm->loadRest(&err)) {
+      ui->statusBar->showMessage("Cannot load the rest of the document: " + err.errorString());
+      return;
+  }
+
+  transfer = transferRate("Read", fileFormat, QFileInfo(ui->currentFile->text()).size(), timer.elapsed());
+
+  QString journalError;
+  if(!ptm->startJournal(ui->currentFile->text(), &journalError))
+    transfer += "; no journal: " + journalError;
+  showMemoryStats();
+
+  QModelIndex target = ptm->indexForPointer(seekPointer);
+  if(target.isValid()) {
+      ui->treeView->setCurrentIndex(target);
+      ui->treeView->scrollTo(target);
+  }
+}
+
+
+/**
+ * @brief MainWindow::openSchema
+ *
+ * Slot connected to the triggered signal of actionSchema.
+ * Asks for a JSON Schema file and validates the document against it, now
+ * and after every edit, on a worker thread. Items with violations are
+ * marked; their tool tip lists the violations. Cancelling the dialog
+ * removes the schema.
+ */
+
+void MainWindow::openSchema()
+{
+  QString         schemaFile;
+  QJsonParseError err;
+  QString         error;
+
+
+  schemaFile = QFileDialog::getOpenFileName(this, QString("Open JSON Schema"), QString("/"));
+  if(schemaFile.isNull()) {
+      schema = JsonSchema();
+      if(ptm != nullptr)
+        ptm->setSchema(schema);
+      ui->statusBar->showMessage("No schema.");
+      return;
+  }
+
+  QFile file(schemaFile);
+  if(!file.open(QIODevice::ReadOnly)) {
+      ui->statusBar->showMessage("Cannot open the schema: " + file.errorString());
+      return;
+  }
+
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
+  if(err.error != QJsonParseError::NoError) {
+      ui->statusBar->showMessage("Schema: " + err.errorString() + " at position " + QString::number(err.offset));
+      return;
+  }
+
+  JsonSchema compiled(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), &error);
+  if(compiled.isNull()) {
+      ui->statusBar->showMessage("Schema: " + error);
+      return;
+  }
+
+  schema = compiled;
+  if(ptm != nullptr)
+    ptm->setSchema(schema);
+}
+
+
+/**
+ * @brief MainWindow::showViolations
+ *
+ * Connected to the validated signal of the model. Reports the number of
+ * values that violate the schema, and the violations of the top-level
+ * value, which has no item in the tree.
+ *
+ * @param violations: Number of values with violations
+ */
+
+void MainWindow::showViolations(int violations)
+{
+  QStringList top = ptm->violationsOf(QString());
+
+
+  if(violations == 0)
+    ui->statusBar->showMessage("The document is valid.");
+  else if(top.isEmpty())
+    ui->statusBar->showMessage(QString("%1 values violate the schema.").arg(violations));
+  else
+    ui->statusBar->showMessage(QString("%1 values violate the schema. Top level: %2").arg(violations).arg(top.join("; ")));
+}
+
+
+/**
+ * @brief MainWindow::showMemoryStats
+ *
+ * Report the number of TreeNodes held by the model in the status bar,
+ * compared with the number of values in the document. Values of arrays
+ * stored column-wise count as values in the document, not as TreeNodes, so
+ * opening a file with and without "Columnar Arrays" compares the two layouts.
+ * With a memory budget, the text held in memory and the subtrees evicted and
+ * read again are reported too.
+ */
+
+void MainWindow::showMemoryStats()
+{
+  JsonTreeModel::MemoryStats stats = ptm->memoryStats();
+  double factor = double(stats.logicalNodes) / qMax(stats.materializedNodes, qint64(1));
+  qint64 kbytes = stats.materializedNodes * qint64(sizeof(TreeNode)) / 1024;
+
+  QString message = transfer + "; " + QString("%1 of %2 nodes built (%3 KiB), %4 shared subtrees, %5 values in %6 columnar arrays, %7x smaller")
+                    .arg(stats.materializedNodes).arg(stats.logicalNodes).arg(kbytes)
+                    .arg(stats.sharedSubtrees).arg(stats.columnarValues).arg(stats.columnarArrays)
+                    .arg(factor, 0, 'f', 1);
+
+  if(ptm->memoryBudget() > 0)
+    message += QString(", %1 of %2 KiB of text in memory, %3 evictions, %4 refaults")
+               .arg((stats.documentBytes - stats.sourceBytes) / 1024).arg(stats.documentBytes / 1024)
+               .arg(stats.evictions).arg(stats.refaults);
+
+  ui->statusBar->showMessage(message);
+}
+
+
 /**
  * @brief MainWindow::saveFile
  *
  * Slot connected to the triggered signal of actionSaveFile.
  * Writes the current PTreeModel back to disc.
- * The file is saved under the same file name that was opened.
+ * The file is saved under the same file name that was opened, in the same
+ * format. Names ending in .gz or .zst are written compressed. Numbers are
+ * saved with the text they were read with.
  *
  */
 void MainWindow::saveFile()
 {
 
   if(ptm != nullptr) {
-      QJsonDocument doc = ptm->toJsonDocument();
-      QByteArray jsonBytes = doc.toJson();
+      if(writeFile(ui->currentFile->text(), fileFormat))
+        ptm->resetModified();   // Reset the model's modified flag, since changes have been saved.
+  }
+  else {
+      ui->statusBar->showMessage("No file to save.");
+  }
+
+}
 
-      QFile outFile(ui->currentFile->text());
-      outFile.open(QIODevice::ReadWrite | QIODevice::Text | QIODevice::Truncate);
-      outFile.write(jsonBytes);
-      outFile.close();
 
-      // Reset the model's modified flag, since changes have been saved.
+/**
+ * @brief MainWindow::saveFileAs
+ *
+ * Slot connected to the triggered signal of actionSaveAs.
+ * Asks for a file name and saves the document under it, as CBOR if the
+ * CBOR filter is chosen or the name ends in .cbor, and as JSON otherwise.
+ * The new file becomes the current file.
+ */
+
+void MainWindow::saveFileAs()
+{
+  QString cborFilter("CBOR Files (*.cbor *.cbor.gz *.cbor.zst)");
+  QString selectedFilter;
+  QString fileName;
+  JsonTreeModel::FileFormat format;
+
+
+  if(ptm == nullptr) {
+      ui->statusBar->showMessage("No file to save.");
+      return;
+  }
+
+  fileName = QFileDialog::getSaveFileName(this, QString("Save As"), ui->currentFile->text(),
+                                          "JSON Files (*.json *.json.gz *.json.zst);;" + cborFilter, &selectedFilter);
+  if(fileName.isEmpty())
+    return;
+
+  format = JsonTreeModel::formatForFile(fileName);
+  if(selectedFilter == cborFilter)
+    format = JsonTreeModel::CborFormat;
+
+  if(writeFile(fileName, format)) {
       ptm->resetModified();
-      ui->statusBar->showMessage("Saved.");
+      fileFormat = format;
+      ui->currentFile->setText(fileName);
   }
-  else {
-      ui->statusBar->showMessage("No file to save.");
+}
+
+
+/**
+ * @brief MainWindow::writeFile
+ *
+ * Write the document to a file, as JSON or CBOR. Names ending in .gz or .zst
+ * are written compressed; the output is compressed as it is produced.
+ * The status bar reports the write time, or the error.
+ *
+ * @param fileName: Name of the file
+ * @param format: Encoding to write
+ * @return Returns true if the file was written.
+ */
+
+bool MainWindow::writeFile(const QString &fileName, JsonTreeModel::FileFormat format)
+{
+  CompressedDevice::Format compression = CompressedDevice::formatForFile(fileName);
+  QFile outFile(fileName);
+  CompressedDevice deflater(&outFile, compression);
+  QIODevice *out = &outFile;
+  QElapsedTimer timer;
+
+
+  // The file may be the one a partial document still reads from.
+  if(ptm->isPartial()) {
+      loadAll();
+      if(ptm->isPartial())
+        return false;
+  }
+
+  // Or the one that values evicted by the memory budget are read back from.
+  if(!ptm->releaseFile(fileName)) {
+      ui->statusBar->showMessage("Cannot save: the values left in " + fileName + " cannot be read back");
+      return false;
+  }
+
+  timer.start();
+  if(!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      ui->statusBar->showMessage("Cannot save: " + outFile.errorString());
+      return false;
+  }
+
+  if(compression != CompressedDevice::Plain) {
+      if(!deflater.open(QIODevice::WriteOnly)) {
+          ui->statusBar->showMessage("Cannot save: " + deflater.errorString());
+          return false;
+      }
+      out = &deflater;
+  }
+
+  if(!ptm->write(out, format)) {
+      ui->statusBar->showMessage("Cannot save: " + out->errorString());
+      return false;
+  }
+
+  if(out == &deflater)
+    deflater.close();
+  outFile.close();
+
+  // The edits are in the file now; record the next ones against it.
+  QString journalError;
+  if(!ptm->startJournal(fileName, &journalError)) {
+      ui->statusBar->showMessage("Saved, but no journal: " + journalError);
+      return true;
+  }
+
+  ui->statusBar->showMessage("Saved. " + transferRate("Wrote", format, QFileInfo(fileName).size(), timer.elapsed()));
+  return true;
+}
+
+
+/**
+ * @brief MainWindow::insertItem
+ *
+ * Slot connected to the triggered signal of actionInsert.
+ * Inserts a null item after the current item, or at the end of the
+ * document if there is no current item.
+ */
+
+void MainWindow::insertItem()
+{
+  if(ptm == nullptr)
+    return;
+
+  QModelIndex current = ui->treeView->currentIndex();
+  bool inserted;
+
+  if(current.isValid())
+    inserted = ptm->insertRow(current.row() + 1, current.parent());
+  else
+    inserted = ptm->insertRow(ptm->rowCount());
+
+  if(inserted == false && ptm->isPartial())
+    ui->statusBar->showMessage("Cannot insert here. Load the rest of the document first.");
+  else if(inserted == false)
+    ui->statusBar->showMessage("Cannot insert here. Restore the document order first.");
+}
+
+
+/**
+ * @brief MainWindow::removeItem
+ *
+ * Slot connected to the triggered signal of actionRemove.
+ * Removes the current item and its subtree.
+ */
+
+void MainWindow::removeItem()
+{
+  if(ptm == nullptr)
+    return;
+
+  QModelIndex current = ui->treeView->currentIndex();
+  if(current.isValid() && ptm->removeRow(current.row(), current.parent()) == false) {
+      if(ptm->isPartial())
+        ui->statusBar->showMessage("Cannot remove here. Load the rest of the document first.");
+      else
+        ui->statusBar->showMessage("Cannot remove here. Restore the document order first.");
+  }
+}
+
+
+/**
+ * @brief MainWindow::sortItems
+ *
+ * Connected to the sortIndicatorChanged signal of the tree view header.
+ * Sorts all objects and arrays by the clicked column.
+ *
+ * @param column: The column to sort by
+ * @param order: The sort order
+ */
+
+void MainWindow::sortItems(int column, Qt::SortOrder order)
+{
+  if(ptm != nullptr && column >= 0)
+    ptm->sort(column, order);
+}
+
+
+/**
+ * @brief MainWindow::filterItems
+ *
+ * Connected to the returnPressed signal of the filter field.
+ * Shows only the siblings of the current item whose text in the current
+ * column contains the filter text; with no current item the top level is filtered.
+ */
+
+void MainWindow::filterItems()
+{
+  if(ptm == nullptr)
+    return;
+
+  QModelIndex current = ui->treeView->currentIndex();
+  ptm->setFilter(current.parent(), qMax(current.column(), 0), filterEdit->text());
+}
+
+
+/**
+ * @brief MainWindow::restoreOrder
+ *
+ * Slot connected to the triggered signal of actionRestore.
+ * Shows the document in its own order, without filters.
+ */
+
+void MainWindow::restoreOrder()
+{
+  if(ptm == nullptr)
+    return;
+
+  ptm->restoreOrder();
+  ui->treeView->header()->setSortIndicator(-1, Qt::AscendingOrder);
+  filterEdit->clear();
+}
+
+
+/**
+ * @brief MainWindow::showTable
+ *
+ * Slot connected to the triggered signal of actionTable.
+ * Opens a window with a JsonTableModel over the current item, if it is an
+ * array stored column-wise, or else over the root.
+ */
+
+void MainWindow::showTable()
+{
+  if(ptm == nullptr)
+    return;
+
+  QModelIndex current = ui->treeView->currentIndex();
+  if(current.isValid())
+    current = current.sibling(current.row(), 0);
+
+  if(ptm->columnStore(current) == nullptr)
+    current = QModelIndex();
+
+  if(ptm->columnStore(current) == nullptr) {
+      ui->statusBar->showMessage("The current item is not an array stored column-wise");
+      return;
   }
 
+  QTableView *table = new QTableView;
+  table->setAttribute(Qt::WA_DeleteOnClose);
+  table->setModel(new JsonTableModel(ptm, current, table));
+  table->setWindowTitle(ui->currentFile->text() + " " + ptm->data(current).toString());
+  table->resize(800, 600);
+  table->show();
+}
+
+
+/**
+ * @brief MainWindow::setBudget
+ *
+ * Connected to the valueChanged signal of the budget field.
+ * Applies the memory budget to the current model. Files opened from now on
+ * are read on demand; see JsonTreeModel::setMemoryBudget().
+ *
+ * @param mebibytes: The budget in MiB; 0 for no limit
+ */
+
+void MainWindow::setBudget(int mebibytes)
+{
+  if(ptm == nullptr)
+    return;
+
+  ptm->setMemoryBudget(qint64(mebibytes) * 1024 * 1024);
+  showMemoryStats();
+}
+
+
+/**
+ * @brief MainWindow::itemExpanded
+ *
+ * Connected to the expanded signal of the tree view. The model only evicts
+ * collapsed items.
+ *
+ * @param index: The expanded item
+ */
+
+void MainWindow::itemExpanded(const QModelIndex &index)
+{
+  if(ptm == nullptr)
+    return;
+
+  ptm->setExpanded(index, true);
+  showMemoryStats();
+}
+
+
+/**
+ * @brief MainWindow::itemCollapsed
+ *
+ * Connected to the collapsed signal of the tree view. Collapsing an item may
+ * evict subtrees to stay within the memory budget.
+ *
+ * @param index: The collapsed item
+ */
+
+void MainWindow::itemCollapsed(const QModelIndex &index)
+{
+  if(ptm == nullptr)
+    return;
+
+  ptm->setExpanded(index, false);
+  showMemoryStats();
 }
 
 
@@ -25,6 +25,8 @@ SOFTWARE.
 #pragma once
 
 #include <QMainWindow>
+#include <QLineEdit>
+#include <QSpinBox>
 #include "jsontreemodel.h"
 
 
@@ -51,12 +53,36 @@ public:
 
 public slots:
   void openFile();
+  void seekFile();
+  void loadAll();
+  void openSchema();
+  void showViolations(int violations);
   void saveFile();
+  void saveFileAs();
+  void insertItem();
+  void removeItem();
+  void sortItems(int column, Qt::SortOrder order);
+  void filterItems();
+  void restoreOrder();
+  void showTable();
+  void setBudget(int mebibytes);
+  void itemExpanded(const QModelIndex &index);
+  void itemCollapsed(const QModelIndex &index);
   void appQuit();
 
 private:
   Ui::MainWindow *ui;
   JsonTreeModel *ptm;
+  QLineEdit     *filterEdit;
+  QSpinBox      *budgetBox;
+  JsonTreeModel::FileFormat fileFormat;
+  QString        transfer;
+  QString        seekPointer;
+  JsonSchema     schema;
 
   int querySave();
+  JsonTreeModel::LoadOptions loadOptions() const;
+  void showModel(JsonTreeModel *model, const QString &jsonFile, const QString &report);
+  bool writeFile(const QString &fileName, JsonTreeModel::FileFormat format);
+  void showMemoryStats();
 };
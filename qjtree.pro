@@ -4,20 +4,50 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = qjtree
 TEMPLATE = app
 
+# std::from_chars for numbers needs C++17 (GCC 11 or later for doubles).
+CONFIG += c++17
+
+LIBS += -lz
+
+# Build with "qmake CONFIG+=zstd" to read and write .zst files.
+zstd {
+    DEFINES += QJTREE_ZSTD
+    LIBS += -lzstd
+}
+
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-    jsontreemodel.cpp
+    jsontreemodel.cpp \
+    columnstore.cpp \
+    jsontablemodel.cpp \
+    compresseddevice.cpp \
+    jsonstream.cpp \
+    cborstream.cpp \
+    jsonsnapshot.cpp \
+    jsonpointer.cpp \
+    jsonschema.cpp \
+    editjournal.cpp
 
 HEADERS  += mainwindow.h \
-    jsontreemodel.h
+    jsontreemodel.h \
+    columnstore.h \
+    jsontablemodel.h \
+    compresseddevice.h \
+    jsonstream.h \
+    cborstream.h \
+    jsonsnapshot.h \
+    jsonpointer.h \
+    jsonschema.h \
+    editjournal.h \
+    jsontreecore.h
 
 FORMS    += mainwindow.ui
 
@@ -0,0 +1,119 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "jsonschema.h"
+
+
+/**
+ * @brief The TestJsonSchema class
+ *
+ * Checks that schemas which cannot be validated are refused, and that
+ * JsonSchema::revalidate() after an edit gives the same violations as
+ * JsonSchema::validate() of the whole edited document.
+ */
+class TestJsonSchema : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void revalidateIfBranch();
+  void rejectRefCycle();
+};
+
+
+/**
+ * @brief json
+ * @return Returns the value of a JSON text.
+ */
+
+static QJsonValue json(const char *text)
+{
+  return QJsonDocument::fromJson(QByteArray(text)).object();
+}
+
+
+/**
+ * @brief TestJsonSchema::revalidateIfBranch
+ *
+ * Editing the member tested by an "if" changes the rules of its siblings:
+ * the violation at /x must appear, and disappear again, with the branch.
+ */
+
+void TestJsonSchema::revalidateIfBranch()
+{
+  QString error;
+  JsonSchema schema(json("{\"if\": {\"properties\": {\"kind\": {\"const\": \"a\"}}},"
+                         " \"then\": {\"properties\": {\"x\": {\"type\": \"number\"}}}}"), &error);
+  QMap<QString, QStringList> results;
+
+
+  QVERIFY(error.isEmpty());
+
+  schema.validate(json("{\"kind\": \"b\", \"x\": \"text\"}")).applyTo(&results);
+  QVERIFY(results.isEmpty());
+
+  QJsonValue edited = json("{\"kind\": \"a\", \"x\": \"text\"}");
+  schema.revalidate(edited, {QStringList{"kind"}}).applyTo(&results);
+  QCOMPARE(results, schema.validate(edited).found);
+  QVERIFY(results.contains("/x"));
+
+  edited = json("{\"kind\": \"b\", \"x\": \"text\"}");
+  schema.revalidate(edited, {QStringList{"kind"}}).applyTo(&results);
+  QVERIFY(results.isEmpty());
+}
+
+
+/**
+ * @brief TestJsonSchema::rejectRefCycle
+ *
+ * A "$ref" back to the same value is refused when the schema is compiled;
+ * one reached through "properties" describes a recursive document.
+ */
+
+void TestJsonSchema::rejectRefCycle()
+{
+  QString error;
+
+
+  JsonSchema loop(json("{\"allOf\": [{\"$ref\": \"#\"}]}"), &error);
+  QVERIFY(!error.isEmpty());
+  QVERIFY(loop.isNull());
+
+  JsonSchema self(json("{\"definitions\": {\"a\": {\"anyOf\": [{\"$ref\": \"#/definitions/a\"}]}},"
+                       " \"$ref\": \"#/definitions/a\"}"), &error);
+  QVERIFY(!error.isEmpty());
+
+  JsonSchema tree(json("{\"properties\": {\"child\": {\"$ref\": \"#\"}}}"), &error);
+  QVERIFY(error.isEmpty());
+  QVERIFY(tree.validate(json("{\"child\": {\"child\": {}}}")).found.isEmpty());
+}
+
+
+QTEST_APPLESS_MAIN(TestJsonSchema)
+
+#include "tst_jsonschema.moc"
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Tests of JsonSchema. Build and run with "qmake && make check".
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = tst_jsonschema
+CONFIG += console testcase c++17
+CONFIG -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_jsonschema.cpp \
+    ../../jsonschema.cpp \
+    ../../jsonpointer.cpp \
+    ../../jsonstream.cpp
+
+HEADERS  += ../../jsonschema.h \
+    ../../jsonpointer.h \
+    ../../jsonstream.h
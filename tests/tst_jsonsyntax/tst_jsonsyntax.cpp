@@ -0,0 +1,192 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Charles Bushakra
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <QtTest>
+#include "jsonstream.h"
+#include "jsonpointer.h"
+
+
+/**
+ * @brief The TestJsonSyntax class
+ *
+ * Checks the number grammar of JsonStreamReader::isNumber(), the array
+ * indices accepted by JsonPointer::arrayIndex(), and the byte ranges of a
+ * shallow JsonStreamReader::read().
+ */
+class TestJsonSyntax : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void isNumber_data();
+  void isNumber();
+  void arrayIndex_data();
+  void arrayIndex();
+  void shallowRead();
+  void shallowReadUnterminated();
+};
+
+
+/**
+ * @brief TestJsonSyntax::isNumber_data
+ *
+ * Texts that look like numbers but are not JSON numbers, and some that are.
+ */
+
+void TestJsonSyntax::isNumber_data()
+{
+  QTest::addColumn<QByteArray>("text");
+  QTest::addColumn<bool>("number");
+
+  QTest::newRow("0") << QByteArray("0") << true;
+  QTest::newRow("-0") << QByteArray("-0") << true;
+  QTest::newRow("12") << QByteArray("12") << true;
+  QTest::newRow("-1.5e+3") << QByteArray("-1.5e+3") << true;
+  QTest::newRow("0.25E-2") << QByteArray("0.25E-2") << true;
+  QTest::newRow("01") << QByteArray("01") << false;
+  QTest::newRow("1.") << QByteArray("1.") << false;
+  QTest::newRow(".5") << QByteArray(".5") << false;
+  QTest::newRow("+1") << QByteArray("+1") << false;
+  QTest::newRow("1e") << QByteArray("1e") << false;
+  QTest::newRow("-") << QByteArray("-") << false;
+  QTest::newRow("inf") << QByteArray("inf") << false;
+  QTest::newRow("nan") << QByteArray("nan") << false;
+  QTest::newRow("empty") << QByteArray("") << false;
+}
+
+
+/**
+ * @brief TestJsonSyntax::isNumber
+ */
+
+void TestJsonSyntax::isNumber()
+{
+  QFETCH(QByteArray, text);
+  QFETCH(bool, number);
+
+
+  QCOMPARE(JsonStreamReader::isNumber(text.constData(), text.size()), number);
+}
+
+
+/**
+ * @brief TestJsonSyntax::arrayIndex_data
+ *
+ * Reference tokens that are array indices, and some that only convert to
+ * an integer.
+ */
+
+void TestJsonSyntax::arrayIndex_data()
+{
+  QTest::addColumn<QString>("token");
+  QTest::addColumn<bool>("valid");
+  QTest::addColumn<int>("index");
+
+  QTest::newRow("0") << QString("0") << true << 0;
+  QTest::newRow("12") << QString("12") << true << 12;
+  QTest::newRow("01") << QString("01") << false << 0;
+  QTest::newRow("1.") << QString("1.") << false << 0;
+  QTest::newRow("+1") << QString("+1") << false << 0;
+  QTest::newRow("-0") << QString("-0") << false << 0;
+  QTest::newRow("-1") << QString("-1") << false << 0;
+  QTest::newRow("inf") << QString("inf") << false << 0;
+  QTest::newRow("empty") << QString("") << false << 0;
+  QTest::newRow("overflow") << QString("99999999999") << false << 0;
+}
+
+
+/**
+ * @brief TestJsonSyntax::arrayIndex
+ */
+
+void TestJsonSyntax::arrayIndex()
+{
+  QFETCH(QString, token);
+  QFETCH(bool, valid);
+  QFETCH(int, index);
+  int result = -1;
+
+
+  QCOMPARE(JsonPointer::arrayIndex(token, &result), valid);
+  if(valid)
+    QCOMPARE(result, index);
+}
+
+
+/**
+ * @brief TestJsonSyntax::shallowRead
+ *
+ * Members that are objects or arrays are left empty, with the range of their
+ * text; empty ones and scalars are read. Of duplicate keys the last one counts.
+ */
+
+void TestJsonSyntax::shallowRead()
+{
+  QByteArray text("{\"a\": {\"x\": [1, \"]\"]}, \"b\": [], \"c\": 1.50, \"d\": [2], \"d\": 3,\n \"e\": [{}, [3]]}");
+  JsonStreamReader reader(text.constData(), text.size());
+  QJsonParseError err;
+
+
+  reader.setShallow(true);
+  QJsonObject top = reader.read(&err).toObject();
+  QHash<QString, SourceRange> ranges = reader.skipped();
+
+  QCOMPARE(err.error, QJsonParseError::NoError);
+  QCOMPARE(top.value("a"), QJsonValue(QJsonObject()));
+  QCOMPARE(top.value("b"), QJsonValue(QJsonArray()));
+  QCOMPARE(top.value("c").toDouble(), 1.5);
+  QCOMPARE(top.value("d").toDouble(), 3.0);
+  QCOMPARE(ranges.keys().count(), 2);
+  QCOMPARE(text.mid(int(ranges["a"].start), int(ranges["a"].end - ranges["a"].start)), QByteArray("{\"x\": [1, \"]\"]}"));
+  QCOMPARE(text.mid(int(ranges["e"].start), int(ranges["e"].end - ranges["e"].start)), QByteArray("[{}, [3]]"));
+  QCOMPARE(reader.rawText()->numbers.value("c"), QByteArray("1.50"));
+}
+
+
+/**
+ * @brief TestJsonSyntax::shallowReadUnterminated
+ *
+ * A skipped member that is not closed before the end of the text is an error,
+ * since the top-level value still has to be closed after it.
+ */
+
+void TestJsonSyntax::shallowReadUnterminated()
+{
+  QByteArray text("[1, {\"a\": [2]}");
+  JsonStreamReader reader(text.constData(), text.size());
+  QJsonParseError err;
+
+
+  reader.setShallow(true);
+  reader.read(&err);
+
+  QCOMPARE(err.error, QJsonParseError::UnterminatedArray);
+  QVERIFY(reader.skipped().isEmpty());
+}
+
+
+QTEST_APPLESS_MAIN(TestJsonSyntax)
+
+#include "tst_jsonsyntax.moc"
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Tests of the JSON number and JSON Pointer syntax, and of shallow reads.
+# Build and run with "qmake && make check".
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = tst_jsonsyntax
+CONFIG += console testcase c++17
+CONFIG -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_jsonsyntax.cpp \
+    ../../jsonpointer.cpp \
+    ../../jsonstream.cpp
+
+HEADERS  += ../../jsonpointer.h \
+    ../../jsonstream.h